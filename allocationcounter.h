@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 René J.V. Bertin <gmail:rjvbertin>
+** Contact: gmail:rjvbertin
+**
+** This file is an extension for the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+/*
+  Counts every heap allocation, including the ones QString makes inside QtCore, by
+  interposing malloc(), calloc() and realloc(). This is for the test and benchmark
+  programs only: include it from one source file of a program, whose allocator it
+  replaces. It only works with glibc, and not with the sanitizers, which bring their
+  own allocator; COUNT_ALLOCATIONS is defined when it does. Define
+  QEMUSTRINGVIEW_NO_MALLOC_HOOK to leave the allocator alone.
+*/
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <cstddef>
+
+static std::atomic<quint64> allocationCount(0);
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__) \
+    && !defined(QEMUSTRINGVIEW_NO_MALLOC_HOOK)
+#define COUNT_ALLOCATIONS
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) Q_DECL_NOTHROW
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void *calloc(size_t n, size_t size) Q_DECL_NOTHROW
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+void *realloc(void *ptr, size_t size) Q_DECL_NOTHROW
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+#endif // ALLOCATIONCOUNTER_H
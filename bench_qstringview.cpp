@@ -0,0 +1,1395 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 René J.V. Bertin <gmail:rjvbertin>
+** Contact: gmail:rjvbertin
+**
+** This file is an extension for the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QString>
+
+#include <QChar>
+#include <QStringRef>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QHash>
+#include <QBuffer>
+#include <QFile>
+#include <QTemporaryFile>
+
+#include <QTest>
+#include <QDebug>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#if __cplusplus >= 201703L && defined(__has_include)
+#  if __has_include(<string_view>)
+#    include <string_view>
+#    define HAVE_STD_U16STRING_VIEW
+#  endif
+#endif
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0) && !defined(QSTRINGVIEW_EMULATE)
+#define QSTRINGVIEW_EMULATE
+#endif
+#include "qemustringview.h"
+#include "qemustringviewalgorithms.h"
+#include "qemumappedstringview.h"
+#include "qemurecordreader.h"
+#include "allocationcounter.h"
+
+#ifndef QSTRINGVIEW_EMULATE
+#define HAVE_NATIVE_QSTRINGVIEW
+#endif
+
+// keep the compiler from optimising away the benchmarked expression
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(Q_CC_GNU) || defined(Q_CC_CLANG)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+// Reports ns/op and allocations/op over all the iterations QBENCHMARK ran;
+// QBENCHMARK itself only reports the total walltime.
+class Measurement
+{
+public:
+    Measurement()
+        : m_allocations(allocationCount.load())
+        , m_iterations(0)
+    {
+        m_timer.start();
+    }
+    ~Measurement()
+    {
+        const qint64 nsecs = m_timer.nsecsElapsed();
+        const quint64 allocations = allocationCount.load() - m_allocations;
+        if (!m_iterations)
+            return;
+#ifdef COUNT_ALLOCATIONS
+        qDebug("%s: %.1f ns/op, %.2f allocs/op", QTest::currentDataTag() ? QTest::currentDataTag() : "",
+               double(nsecs) / m_iterations, double(allocations) / m_iterations);
+#else
+        Q_UNUSED(allocations);
+        qDebug("%s: %.1f ns/op", QTest::currentDataTag() ? QTest::currentDataTag() : "",
+               double(nsecs) / m_iterations);
+#endif
+    }
+    void tick() { ++m_iterations; }
+
+private:
+    QElapsedTimer m_timer;
+    const quint64 m_allocations;
+    quint64 m_iterations;
+};
+
+enum Implementation {
+    Emulated,
+    Native,
+    StdU16StringView,
+    // for operations that used to need one
+    PlainQString
+};
+
+// where toPrettyUnicode() writes to
+enum PrettyUnicodeTarget {
+    PrettyNew,
+    PrettyBuffer,
+    PrettyByteArray
+};
+
+enum BuildMethod {
+    BuildWithBuilder,
+    BuildWithPercent,
+    BuildWithAppend
+};
+
+enum ValidationMethod {
+    ValidateWithView,
+    ValidateWithQChar,
+    DecodeWithCodePoints,
+    DecodeWithQChar
+};
+
+enum BulkOperation {
+    BulkSort,
+    BulkDedup,
+    BulkFindAll
+};
+
+static const char16_t helloWorld[] = u"Hello, World!";
+
+template <typename String>
+static String makeString(int length, char16_t last = u'x')
+{
+    String s;
+    for (int i = 0; i < length; ++i)
+        s.push_back(typename String::value_type('a' + i % 26));
+    if (length)
+        s.back() = typename String::value_type(last);
+    return s;
+}
+
+class tst_bench_QStringView : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    // construction from every source type handled in tst_qstringview.cpp
+    void fromQString_data() const { implementations(); }
+    void fromQString() const { construct(QString::fromUtf16(reinterpret_cast<const ushort *>(helloWorld))); }
+    void fromQStringRef_data() const { implementations(); }
+    void fromQStringRef() const
+    {
+        const QString s = QString::fromUtf16(reinterpret_cast<const ushort *>(helloWorld));
+        construct(QStringRef(&s));
+    }
+    void fromQCharStar_data() const { implementations(); }
+    void fromQCharStar() const { construct(reinterpret_cast<const QChar *>(helloWorld)); }
+    void fromUShortStar_data() const { implementations(); }
+    void fromUShortStar() const { construct(reinterpret_cast<const ushort *>(helloWorld)); }
+    void fromChar16TStar_data() const { implementations(); }
+    void fromChar16TStar() const { construct(static_cast<const char16_t *>(helloWorld)); }
+    void fromWCharTStar_data() const { implementations(); }
+    void fromWCharTStar() const { construct(static_cast<const wchar_t *>(L"Hello, World!")); }
+    void fromQCharRange_data() const { implementations(); }
+    void fromQCharRange() const { constructRange(reinterpret_cast<const QChar *>(helloWorld)); }
+    void fromUShortRange_data() const { implementations(); }
+    void fromUShortRange() const { constructRange(reinterpret_cast<const ushort *>(helloWorld)); }
+    void fromChar16TRange_data() const { implementations(); }
+    void fromChar16TRange() const { constructRange(static_cast<const char16_t *>(helloWorld)); }
+    void fromWCharTRange_data() const { implementations(); }
+    void fromWCharTRange() const { constructRange(static_cast<const wchar_t *>(L"Hello, World!")); }
+    void fromStdStringChar16T_data() const { implementations(); }
+    void fromStdStringChar16T() const { construct(std::u16string(helloWorld)); }
+    void fromStdStringWCharT_data() const { implementations(); }
+    void fromStdStringWCharT() const { construct(std::wstring(L"Hello, World!")); }
+
+    void compareEqual_data() const { implementationsAndLengths(); }
+    void compareEqual() const;
+    void compareLess_data() const { implementationsAndLengths(); }
+    void compareLess() const;
+    void compareCharStar_data() const { implementationsAndLengths(); }
+    void compareCharStar() const;
+
+    void toString_data() const { implementationsAndLengths(); }
+    void toString() const;
+    // what a tokenizer does to every input line
+    void sliceFields_data() const { implementations(); }
+    void sliceFields() const;
+    void splitFields_data() const;
+    void splitFields() const;
+
+    // log filtering: the match, if any, is at the very end
+    void indexOfChar_data() const { implementationsAndLengths(); }
+    void indexOfChar() const;
+    void indexOfString_data() const { implementationsAndLengths(); }
+    void indexOfString() const;
+    void indexOfStringCaseInsensitive_data() const { implementationsAndLengths(); }
+    void indexOfStringCaseInsensitive() const;
+
+    // header/key matching: equal up to case, so everything is compared
+    void compareCaseInsensitive_data() const;
+    void compareCaseInsensitive() const;
+
+    // serialising: mostly ASCII with the odd accented character
+    void toUtf8_data() const;
+    void toUtf8() const;
+    void toUtf8IntoReservedBuffer_data() const { toUtf8_data(); }
+    void toUtf8IntoReservedBuffer() const;
+    void toLatin1_data() const { toUtf8_data(); }
+    void toLatin1() const;
+    // sanitising untrusted input: every surrogate must be half of a pair
+    void validateUtf16_data() const;
+    void validateUtf16() const;
+
+    // decoding the same text back, the QString way and into a reused buffer
+    void fromUtf8_data() const;
+    void fromUtf8() const;
+    // one request's worth of decoded, lower-cased header fields, all kept until the end
+    void materializeFields_data() const;
+    void materializeFields() const;
+
+    // numeric fields of a record, parsed from the view or from a QString of it
+    void parseNumbers_data() const;
+    void parseNumbers() const;
+
+    // looking parsed fields up in a QString-keyed table
+    void hashLookup_data() const;
+    void hashLookup() const;
+    // mapping the column names of a record to small ids
+    void internIdentifiers_data() const;
+    void internIdentifiers() const;
+    // sorting, deduplicating and searching a million views on 1..N threads
+    void parallelBulk_data() const;
+    void parallelBulk() const;
+    // the lines of a UTF-16 log file, mapped or read and converted into a QString
+    void readLogFile_data() const;
+    void readLogFile() const;
+    // the lines of a UTF-8 stream, from a ring buffer or with QIODevice::readLine()
+    void readRecords_data() const;
+    void readRecords() const;
+    // a response put together from two dozen fragments
+    void buildResponse_data() const;
+    void buildResponse() const;
+
+    void qustrlen_data() const;
+    void qustrlen() const;
+
+    void toPrettyUnicode_data() const;
+    void toPrettyUnicode() const;
+
+private:
+    void implementations() const;
+    void implementationsAndLengths() const;
+
+    template <typename Source>
+    void construct(const Source &source) const;
+    template <typename View, typename Source>
+    void construct(const Source &source, std::true_type) const;
+    template <typename View, typename Source>
+    void construct(const Source &, std::false_type) const
+    { QSKIP("this implementation cannot be constructed from this source type"); }
+
+    template <typename Char>
+    void constructRange(const Char *str) const;
+    template <typename View, typename Char>
+    void constructRange(const Char *first, const Char *last, std::true_type) const;
+    template <typename View, typename Char>
+    void constructRange(const Char *, const Char *, std::false_type) const
+    { QSKIP("this implementation cannot be constructed from this range type"); }
+
+    template <typename View>
+    void compareEqual(const std::u16string &a, const std::u16string &b) const;
+    template <typename View>
+    void compareLess(const std::u16string &a, const std::u16string &b) const;
+    template <typename View>
+    void compareCharStar(const std::u16string &a, const std::u16string &b) const;
+    template <typename View>
+    void toString(const std::u16string &a) const;
+    template <typename View>
+    void sliceFields(const std::u16string &line) const;
+    template <typename View>
+    void indexOfChar(const std::u16string &haystack, char16_t needle) const;
+    template <typename View>
+    void indexOfString(const std::u16string &haystack, const std::u16string &needle, Qt::CaseSensitivity cs) const;
+    template <typename View>
+    void compareCaseInsensitive(const std::u16string &a, const std::u16string &b) const;
+};
+
+void tst_bench_QStringView::implementations() const
+{
+    QTest::addColumn<int>("implementation");
+
+    QTest::newRow("QEmuStringView") << int(Emulated);
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+    QTest::newRow("QStringView") << int(Native);
+#endif
+#ifdef HAVE_STD_U16STRING_VIEW
+    QTest::newRow("std::u16string_view") << int(StdU16StringView);
+#endif
+}
+
+void tst_bench_QStringView::implementationsAndLengths() const
+{
+    QTest::addColumn<int>("implementation");
+    QTest::addColumn<int>("length");
+
+    for (int length : {8, 64, 1024}) {
+        const QByteArray n = '/' + QByteArray::number(length);
+        QTest::newRow(QByteArray("QEmuStringView" + n).constData()) << int(Emulated) << length;
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+        QTest::newRow(QByteArray("QStringView" + n).constData()) << int(Native) << length;
+#endif
+#ifdef HAVE_STD_U16STRING_VIEW
+        QTest::newRow(QByteArray("std::u16string_view" + n).constData()) << int(StdU16StringView) << length;
+#endif
+    }
+}
+
+template <typename Source>
+void tst_bench_QStringView::construct(const Source &source) const
+{
+    QFETCH(int, implementation);
+
+    switch (implementation) {
+    case Emulated:
+        construct<QEmuStringView>(source, std::is_constructible<QEmuStringView, const Source &>());
+        break;
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+    case Native:
+        construct<QStringView>(source, std::is_constructible<QStringView, const Source &>());
+        break;
+#endif
+#ifdef HAVE_STD_U16STRING_VIEW
+    case StdU16StringView:
+        construct<std::u16string_view>(source, std::is_constructible<std::u16string_view, const Source &>());
+        break;
+#endif
+    }
+}
+
+template <typename View, typename Source>
+void tst_bench_QStringView::construct(const Source &source, std::true_type) const
+{
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const View v(source);
+        doNotOptimize(v);
+    }
+}
+
+template <typename Char>
+void tst_bench_QStringView::constructRange(const Char *str) const
+{
+    QFETCH(int, implementation);
+    const Char *last = str + QEmuStringView::lengthHelperPointer(str);
+
+    switch (implementation) {
+    case Emulated:
+        constructRange<QEmuStringView>(str, last, std::is_constructible<QEmuStringView, const Char *, const Char *>());
+        break;
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+    case Native:
+        constructRange<QStringView>(str, last, std::is_constructible<QStringView, const Char *, const Char *>());
+        break;
+#endif
+#ifdef HAVE_STD_U16STRING_VIEW
+    case StdU16StringView:
+        constructRange<std::u16string_view>(str, last, std::false_type());
+        break;
+#endif
+    }
+}
+
+template <typename View, typename Char>
+void tst_bench_QStringView::constructRange(const Char *first, const Char *last, std::true_type) const
+{
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const View v(first, last);
+        doNotOptimize(v);
+    }
+}
+
+#define DISPATCH(function, ...) \
+    do { \
+        QFETCH(int, implementation); \
+        switch (implementation) { \
+        case Emulated: function<QEmuStringView>(__VA_ARGS__); break; \
+        DISPATCH_NATIVE(function, __VA_ARGS__) \
+        DISPATCH_STD(function, __VA_ARGS__) \
+        } \
+    } while (false)
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+#define DISPATCH_NATIVE(function, ...) case Native: function<QStringView>(__VA_ARGS__); break;
+#else
+#define DISPATCH_NATIVE(function, ...)
+#endif
+#ifdef HAVE_STD_U16STRING_VIEW
+#define DISPATCH_STD(function, ...) case StdU16StringView: function<std::u16string_view>(__VA_ARGS__); break;
+#else
+#define DISPATCH_STD(function, ...)
+#endif
+
+void tst_bench_QStringView::compareEqual() const
+{
+    QFETCH(int, length);
+    // equal contents at different addresses, so the whole string is scanned
+    const std::u16string a = makeString<std::u16string>(length);
+    const std::u16string b = a;
+    DISPATCH(compareEqual, a, b);
+}
+
+template <typename View>
+void tst_bench_QStringView::compareEqual(const std::u16string &a, const std::u16string &b) const
+{
+    const View va(a.data(), a.size());
+    const View vb(b.data(), b.size());
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const bool result = va == vb;
+        doNotOptimize(result);
+    }
+}
+
+void tst_bench_QStringView::compareLess() const
+{
+    QFETCH(int, length);
+    const std::u16string a = makeString<std::u16string>(length, u'x');
+    const std::u16string b = makeString<std::u16string>(length, u'y');
+    DISPATCH(compareLess, a, b);
+}
+
+template <typename View>
+void tst_bench_QStringView::compareLess(const std::u16string &a, const std::u16string &b) const
+{
+    const View va(a.data(), a.size());
+    const View vb(b.data(), b.size());
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const bool result = va < vb;
+        doNotOptimize(result);
+    }
+}
+
+void tst_bench_QStringView::compareCharStar() const
+{
+    QFETCH(int, length);
+    const std::u16string a = makeString<std::u16string>(length);
+    const std::u16string b = a;
+    DISPATCH(compareCharStar, a, b);
+}
+
+template <typename View>
+void tst_bench_QStringView::compareCharStar(const std::u16string &a, const std::u16string &b) const
+{
+    const View va(a.data(), a.size());
+    const char16_t *rhs = b.c_str();
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const bool result = va == rhs;
+        doNotOptimize(result);
+    }
+}
+
+template <typename View>
+static inline QString toOwning(const View &v) { return v.toString(); }
+#ifdef HAVE_STD_U16STRING_VIEW
+static inline std::u16string toOwning(std::u16string_view v) { return std::u16string(v); }
+#endif
+
+void tst_bench_QStringView::toString() const
+{
+    QFETCH(int, length);
+    const std::u16string a = makeString<std::u16string>(length);
+    DISPATCH(toString, a);
+}
+
+template <typename View>
+void tst_bench_QStringView::toString(const std::u16string &a) const
+{
+    const View v(a.data(), a.size());
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const auto s = toOwning(v);
+        doNotOptimize(s);
+    }
+}
+
+template <typename View>
+static inline View midOf(const View &v, qsizetype pos, qsizetype n) { return v.mid(pos, n); }
+#ifdef HAVE_STD_U16STRING_VIEW
+static inline std::u16string_view midOf(std::u16string_view v, qsizetype pos, qsizetype n) { return v.substr(pos, n); }
+#endif
+
+void tst_bench_QStringView::sliceFields() const
+{
+    std::u16string line;
+    for (int i = 0; i < 32; ++i)
+        line += makeString<std::u16string>(4 + i % 8) + u',';
+    DISPATCH(sliceFields, line);
+}
+
+template <typename View>
+void tst_bench_QStringView::sliceFields(const std::u16string &line) const
+{
+    const View v(line.data(), line.size());
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        qsizetype from = 0;
+        for (qsizetype i = 0; i < qsizetype(line.size()); ++i) {
+            if (line[i] == u',') {
+                const View field = midOf(v, from, i - from);
+                doNotOptimize(field);
+                from = i + 1;
+            }
+        }
+    }
+}
+
+void tst_bench_QStringView::splitFields_data() const
+{
+    QTest::addColumn<int>("implementation");
+    QTest::addColumn<int>("length");
+
+    for (int fields : {8, 64}) {
+        const QByteArray n = '/' + QByteArray::number(fields);
+        QTest::newRow(QByteArray("QEmuStringView::split" + n).constData()) << int(Emulated) << fields;
+        QTest::newRow(QByteArray("QString::split" + n).constData()) << int(PlainQString) << fields;
+    }
+}
+
+void tst_bench_QStringView::splitFields() const
+{
+    QFETCH(int, implementation);
+    QFETCH(int, length);
+    std::u16string line;
+    for (int i = 0; i < length; ++i)
+        line += makeString<std::u16string>(4 + i % 8) + u',';
+    const QEmuStringView v(line.data(), qsizetype(line.size()));
+    const QString str = QString::fromUtf16(reinterpret_cast<const ushort *>(line.data()), int(line.size()));
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        if (implementation == Emulated) {
+            for (QEmuStringView field : v.split(QLatin1Char(',')))
+                doNotOptimize(field);
+        } else {
+            for (const QString &field : str.split(QLatin1Char(',')))
+                doNotOptimize(field);
+        }
+    }
+}
+
+template <typename View>
+struct SupportsCaseInsensitive : std::true_type {};
+
+template <typename View>
+static inline qsizetype search(const View &v, char16_t c) { return v.indexOf(QChar(c)); }
+template <typename View>
+static inline qsizetype search(const View &v, const View &s, Qt::CaseSensitivity cs) { return v.indexOf(s, 0, cs); }
+template <typename View>
+static inline int compareIgnoringCase(const View &a, const View &b) { return a.compare(b, Qt::CaseInsensitive); }
+#if defined(HAVE_NATIVE_QSTRINGVIEW) && QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+// QStringView only learnt to search in 5.14
+template <>
+struct SupportsCaseInsensitive<QStringView> : std::false_type {};
+static inline qsizetype search(QStringView v, char16_t c)
+{
+    const QChar *it = std::find(v.begin(), v.end(), QChar(c));
+    return it == v.end() ? -1 : it - v.begin();
+}
+static inline int compareIgnoringCase(QStringView, QStringView) { return 0; }
+static inline qsizetype search(QStringView v, QStringView s, Qt::CaseSensitivity)
+{
+    const QChar *it = std::search(v.begin(), v.end(), s.begin(), s.end());
+    return it == v.end() ? -1 : it - v.begin();
+}
+#endif
+#ifdef HAVE_STD_U16STRING_VIEW
+template <>
+struct SupportsCaseInsensitive<std::u16string_view> : std::false_type {};
+static inline int compareIgnoringCase(std::u16string_view, std::u16string_view) { return 0; }
+static inline qsizetype search(std::u16string_view v, char16_t c) { return qsizetype(v.find(c)); }
+static inline qsizetype search(std::u16string_view v, std::u16string_view s, Qt::CaseSensitivity)
+{ return qsizetype(v.find(s)); }
+#endif
+
+void tst_bench_QStringView::indexOfChar() const
+{
+    QFETCH(int, length);
+    const std::u16string haystack = makeString<std::u16string>(length, u'#');
+    DISPATCH(indexOfChar, haystack, u'#');
+}
+
+template <typename View>
+void tst_bench_QStringView::indexOfChar(const std::u16string &haystack, char16_t needle) const
+{
+    const View v(haystack.data(), haystack.size());
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const qsizetype result = search(v, needle);
+        doNotOptimize(result);
+    }
+}
+
+void tst_bench_QStringView::indexOfString() const
+{
+    QFETCH(int, length);
+    const std::u16string haystack = makeString<std::u16string>(length) + u"needle#";
+    DISPATCH(indexOfString, haystack, u"needle#", Qt::CaseSensitive);
+}
+
+void tst_bench_QStringView::indexOfStringCaseInsensitive() const
+{
+    QFETCH(int, length);
+    const std::u16string haystack = makeString<std::u16string>(length) + u"needle#";
+    DISPATCH(indexOfString, haystack, u"NEEDLE#", Qt::CaseInsensitive);
+}
+
+template <typename View>
+void tst_bench_QStringView::indexOfString(const std::u16string &haystack, const std::u16string &needle,
+                                          Qt::CaseSensitivity cs) const
+{
+    if (cs == Qt::CaseInsensitive && !SupportsCaseInsensitive<View>::value)
+        QSKIP("no case-insensitive search to compare with");
+    const View v(haystack.data(), haystack.size());
+    const View n(needle.data(), needle.size());
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const qsizetype result = search(v, n, cs);
+        doNotOptimize(result);
+    }
+}
+
+void tst_bench_QStringView::compareCaseInsensitive_data() const
+{
+    implementationsAndLengths();
+    for (int length : {8, 64, 1024})
+        QTest::newRow(QByteArray("QString/" + QByteArray::number(length)).constData()) << int(PlainQString) << length;
+}
+
+void tst_bench_QStringView::compareCaseInsensitive() const
+{
+    QFETCH(int, implementation);
+    QFETCH(int, length);
+    const std::u16string a = makeString<std::u16string>(length);
+    std::u16string b = a;
+    for (char16_t &c : b)
+        c = char16_t(QChar::toUpper(uint(c)));
+
+    if (implementation == PlainQString) {
+        const QString qa = QString::fromUtf16(reinterpret_cast<const ushort *>(a.data()), int(a.size()));
+        const QString qb = QString::fromUtf16(reinterpret_cast<const ushort *>(b.data()), int(b.size()));
+        Measurement m;
+        QBENCHMARK {
+            m.tick();
+            const int result = qa.compare(qb, Qt::CaseInsensitive);
+            doNotOptimize(result);
+        }
+        return;
+    }
+    DISPATCH(compareCaseInsensitive, a, b);
+}
+
+template <typename View>
+void tst_bench_QStringView::compareCaseInsensitive(const std::u16string &a, const std::u16string &b) const
+{
+    if (!SupportsCaseInsensitive<View>::value)
+        QSKIP("no case-insensitive comparison to compare with");
+    const View va(a.data(), a.size());
+    const View vb(b.data(), b.size());
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const int result = compareIgnoringCase(va, vb);
+        doNotOptimize(result);
+    }
+}
+
+void tst_bench_QStringView::toUtf8_data() const
+{
+    QTest::addColumn<int>("implementation");
+    QTest::addColumn<int>("length");
+
+    for (int length : {8, 64, 1024}) {
+        const QByteArray n = '/' + QByteArray::number(length);
+        QTest::newRow(QByteArray("QEmuStringView" + n).constData()) << int(Emulated) << length;
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+        QTest::newRow(QByteArray("QStringView" + n).constData()) << int(Native) << length;
+#endif
+        QTest::newRow(QByteArray("QString" + n).constData()) << int(PlainQString) << length;
+    }
+}
+
+static std::u16string serialisedText(int length)
+{
+    std::u16string s = makeString<std::u16string>(length);
+    for (int i = 50; i < length; i += 100)
+        s[i] = u'\u00e9';
+    return s;
+}
+
+void tst_bench_QStringView::toUtf8() const
+{
+    QFETCH(int, implementation);
+    QFETCH(int, length);
+    const std::u16string text = serialisedText(length);
+    const QString str = QString::fromUtf16(reinterpret_cast<const ushort *>(text.data()), int(text.size()));
+    const QEmuStringView emulated(text.data(), qsizetype(text.size()));
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+    const QStringView native(text.data(), qsizetype(text.size()));
+#endif
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        QByteArray result;
+        switch (implementation) {
+        case Emulated:
+            result = emulated.toUtf8();
+            break;
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+        case Native:
+            result = native.toUtf8();
+            break;
+#endif
+        case PlainQString:
+            result = str.toUtf8();
+            break;
+        }
+        doNotOptimize(result);
+    }
+}
+
+void tst_bench_QStringView::toUtf8IntoReservedBuffer() const
+{
+    QFETCH(int, implementation);
+    QFETCH(int, length);
+    if (implementation != Emulated)
+        QSKIP("only QEmuStringView encodes into an existing buffer");
+    const std::u16string text = serialisedText(length);
+    const QEmuStringView v(text.data(), qsizetype(text.size()));
+    QByteArray buffer;
+    buffer.reserve(int(v.maxUtf8Size()));
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        v.toUtf8(buffer);
+        doNotOptimize(buffer);
+    }
+}
+
+void tst_bench_QStringView::toLatin1() const
+{
+    QFETCH(int, implementation);
+    QFETCH(int, length);
+    const std::u16string text = serialisedText(length);
+    const QString str = QString::fromUtf16(reinterpret_cast<const ushort *>(text.data()), int(text.size()));
+    const QEmuStringView emulated(text.data(), qsizetype(text.size()));
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+    const QStringView native(text.data(), qsizetype(text.size()));
+#endif
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        QByteArray result;
+        switch (implementation) {
+        case Emulated:
+            result = emulated.toLatin1();
+            break;
+#ifdef HAVE_NATIVE_QSTRINGVIEW
+        case Native:
+            result = native.toLatin1();
+            break;
+#endif
+        case PlainQString:
+            result = str.toLatin1();
+            break;
+        }
+        doNotOptimize(result);
+    }
+}
+
+void tst_bench_QStringView::validateUtf16_data() const
+{
+    QTest::addColumn<int>("method");
+    QTest::addColumn<int>("length");
+
+    for (int length : {64, 1024, 16384}) {
+        const QByteArray n = '/' + QByteArray::number(length);
+        QTest::newRow(QByteArray("isValidUtf16()" + n).constData()) << int(ValidateWithView) << length;
+        QTest::newRow(QByteArray("QChar::isHighSurrogate()" + n).constData()) << int(ValidateWithQChar) << length;
+        QTest::newRow(QByteArray("codePoints()" + n).constData()) << int(DecodeWithCodePoints) << length;
+        QTest::newRow(QByteArray("QChar::surrogateToUcs4()" + n).constData()) << int(DecodeWithQChar) << length;
+    }
+}
+
+void tst_bench_QStringView::validateUtf16() const
+{
+    QFETCH(int, method);
+    QFETCH(int, length);
+    // mostly ASCII, with an accented character and an emoji every so often
+    std::u16string text = serialisedText(length);
+    for (int i = 80; i + 1 < length; i += 200) {
+        text[i] = u'\xd83d';
+        text[i + 1] = u'\xde00';
+    }
+    const QString str = QString::fromUtf16(reinterpret_cast<const ushort *>(text.data()), int(text.size()));
+    const QEmuStringView view(text.data(), qsizetype(text.size()));
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        uint result = 0;
+        switch (method) {
+        case ValidateWithView:
+            result = view.isValidUtf16();
+            break;
+        case ValidateWithQChar:
+            // what a sanitiser without isValidUtf16() does
+            result = 1;
+            for (int i = 0; i < str.size(); ++i) {
+                const QChar c = str.at(i);
+                if (c.isHighSurrogate() && i + 1 < str.size() && str.at(i + 1).isLowSurrogate()) {
+                    ++i;
+                } else if (c.isSurrogate()) {
+                    result = 0;
+                    break;
+                }
+            }
+            break;
+        case DecodeWithCodePoints:
+            for (char32_t c : view.codePoints())
+                result += c;
+            break;
+        case DecodeWithQChar:
+            for (int i = 0; i < str.size(); ++i) {
+                const QChar c = str.at(i);
+                if (c.isHighSurrogate() && i + 1 < str.size() && str.at(i + 1).isLowSurrogate())
+                    result += QChar::surrogateToUcs4(c.unicode(), str.at(++i).unicode());
+                else
+                    result += c.isSurrogate() ? uint(QChar::ReplacementCharacter) : c.unicode();
+            }
+            break;
+        }
+        doNotOptimize(result);
+    }
+}
+
+void tst_bench_QStringView::fromUtf8_data() const
+{
+    QTest::addColumn<int>("implementation");
+    QTest::addColumn<int>("length");
+
+    for (int length : {8, 64, 1024}) {
+        const QByteArray n = '/' + QByteArray::number(length);
+        QTest::newRow(QByteArray("QEmuUtf16Buffer" + n).constData()) << int(Emulated) << length;
+        QTest::newRow(QByteArray("QString" + n).constData()) << int(PlainQString) << length;
+    }
+}
+
+void tst_bench_QStringView::fromUtf8() const
+{
+    QFETCH(int, implementation);
+    QFETCH(int, length);
+    const std::u16string text = serialisedText(length);
+    const QByteArray utf8 = QEmuStringView(text.data(), qsizetype(text.size())).toUtf8();
+    QEmuUtf16Buffer buffer;
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        if (implementation == Emulated) {
+            const QEmuStringView v = buffer.fromUtf8(utf8.constData(), utf8.size());
+            doNotOptimize(v);
+        } else {
+            const QString str = QString::fromUtf8(utf8);
+            doNotOptimize(str);
+        }
+    }
+}
+
+void tst_bench_QStringView::materializeFields_data() const
+{
+    QTest::addColumn<int>("implementation");
+
+    QTest::newRow("QEmuStringArena") << int(Emulated);
+    QTest::newRow("QString") << int(PlainQString);
+}
+
+void tst_bench_QStringView::materializeFields() const
+{
+    QFETCH(int, implementation);
+    QVector<QByteArray> fields;
+    for (int i = 0; i < 64; ++i)
+        fields.append("X-Forwarded-Header-" + QByteArray::number(i) + ": Value=" + QByteArray::number(i * 7919));
+    QEmuStringArena arena;
+    QVector<QEmuStringView> views;
+    QVector<QString> strings;
+    views.reserve(fields.size());
+    strings.reserve(fields.size());
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        if (implementation == Emulated) {
+            for (const QByteArray &field : fields)
+                views.append(arena.toLower(arena.fromUtf8(field)));
+            doNotOptimize(views);
+            views.clear();
+            arena.reset();
+        } else {
+            for (const QByteArray &field : fields)
+                strings.append(QString::fromUtf8(field).toLower());
+            doNotOptimize(strings);
+            strings.clear();
+        }
+    }
+}
+
+void tst_bench_QStringView::parseNumbers_data() const
+{
+    QTest::addColumn<int>("implementation");
+    QTest::addColumn<bool>("floatingPoint");
+
+    QTest::newRow("QEmuStringView::toLongLong") << int(Emulated) << false;
+    QTest::newRow("QString::toLongLong") << int(PlainQString) << false;
+    QTest::newRow("QEmuStringView::toDouble") << int(Emulated) << true;
+    QTest::newRow("QString::toDouble") << int(PlainQString) << true;
+}
+
+void tst_bench_QStringView::parseNumbers() const
+{
+    QFETCH(int, implementation);
+    QFETCH(bool, floatingPoint);
+    const std::u16string text = floatingPoint ? u"12.5,-0.001,3.14159,1e-3,65536.25,7,42.125,-1000.5"
+                                              : u"12,-1,314159,1000,65536,7,1234567890123,-1000";
+    const QEmuStringView record(text.data(), qsizetype(text.size()));
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        for (QEmuStringView field : record.split(QLatin1Char(','))) {
+            bool ok;
+            if (implementation == Emulated) {
+                if (floatingPoint)
+                    doNotOptimize(field.toDouble(&ok));
+                else
+                    doNotOptimize(field.toLongLong(&ok));
+            } else {
+                const QString str = field.toString();
+                if (floatingPoint)
+                    doNotOptimize(str.toDouble(&ok));
+                else
+                    doNotOptimize(str.toLongLong(&ok));
+            }
+        }
+    }
+}
+
+void tst_bench_QStringView::hashLookup_data() const
+{
+    QTest::addColumn<int>("implementation");
+    QTest::addColumn<int>("length");
+
+    for (int length : {8, 64, 1024}) {
+        const QByteArray n = '/' + QByteArray::number(length);
+        QTest::newRow(QByteArray("QEmuStringViewKey" + n).constData()) << int(Emulated) << length;
+        QTest::newRow(QByteArray("toString" + n).constData()) << int(PlainQString) << length;
+    }
+}
+
+void tst_bench_QStringView::hashLookup() const
+{
+    QFETCH(int, implementation);
+    QFETCH(int, length);
+    const std::u16string text = serialisedText(length);
+    const QEmuStringView field(text.data(), qsizetype(text.size()));
+    QHash<QString, int> table;
+    table.insert(field.toString(), 1);
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        int value;
+        if (implementation == Emulated)
+            value = table.value(QEmuStringViewKey(field));
+        else
+            value = table.value(field.toString());
+        doNotOptimize(value);
+    }
+}
+
+void tst_bench_QStringView::internIdentifiers_data() const
+{
+    QTest::addColumn<int>("implementation");
+
+    QTest::newRow("QEmuStringPool") << int(Emulated);
+    QTest::newRow("QHash<QString,int>") << int(PlainQString);
+}
+
+void tst_bench_QStringView::internIdentifiers() const
+{
+    QFETCH(int, implementation);
+    const std::u16string text = u"id,user_name,email_address,created_at,updated_at,status,"
+                                u"country_code,preferred_language,last_login,account_type";
+    const QEmuStringView record(text.data(), qsizetype(text.size()));
+    QEmuStringPool pool;
+    QHash<QString, int> table;
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        int sum = 0;
+        for (QEmuStringView field : record.split(QLatin1Char(','))) {
+            if (implementation == Emulated) {
+                sum += pool.id(field);
+            } else {
+                const QString name = field.toString();
+                int id = table.value(name, -1);
+                if (id < 0) {
+                    id = table.size();
+                    table.insert(name, id);
+                }
+                sum += id;
+            }
+        }
+        doNotOptimize(sum);
+    }
+}
+
+void tst_bench_QStringView::parallelBulk_data() const
+{
+    QTest::addColumn<int>("operation");
+    // 0 for the sequential std:: algorithm
+    QTest::addColumn<int>("threads");
+
+    const int cores = qMax(int(std::thread::hardware_concurrency()), 1);
+    QVector<int> threadCounts;
+    for (int threads = 1; threads < cores; threads *= 2)
+        threadCounts.append(threads);
+    threadCounts.append(cores);
+    static const char *const names[] = { "sort", "dedup", "findAll" };
+    for (int operation : { BulkSort, BulkDedup, BulkFindAll }) {
+        QTest::newRow((QByteArray(names[operation]) + "/std").constData()) << operation << 0;
+        for (int threads : threadCounts) {
+            QTest::newRow((QByteArray(names[operation]) + '/' + QByteArray::number(threads)).constData())
+                << operation << threads;
+        }
+    }
+}
+
+// a million path-like views into one buffer, with shared prefixes and many duplicates
+static const QVector<QEmuStringView> &bulkViews()
+{
+    static std::u16string text;
+    static QVector<QEmuStringView> views;
+    if (views.isEmpty()) {
+        static const char16_t *const dirs[] = { u"/usr/lib/", u"/usr/share/locale/", u"/home/user/src/", u"/tmp/" };
+        const int count = 1000000;
+        std::vector<std::pair<size_t, size_t> > ranges;
+        uint seed = 1;
+        for (int i = 0; i < count; ++i) {
+            seed = seed * 1103515245 + 12345;
+            const size_t begin = text.size();
+            text += dirs[(seed >> 8) % 4];
+            text += u"file_";
+            const std::string number = std::to_string((seed >> 12) % (count / 2));
+            text.append(number.begin(), number.end());
+            text += u"\u00e9.txt";
+            ranges.push_back(std::make_pair(begin, text.size() - begin));
+        }
+        for (const auto &range : ranges)
+            views.append(QEmuStringView(text.data() + range.first, qsizetype(range.second)));
+    }
+    return views;
+}
+
+void tst_bench_QStringView::parallelBulk() const
+{
+    QFETCH(int, operation);
+    QFETCH(int, threads);
+    const QVector<QEmuStringView> &views = bulkViews();
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        if (operation == BulkFindAll) {
+            qsizetype found = 0;
+            if (threads) {
+                found = QEmuParallel::findAll(views, u"locale/file_12", Qt::CaseSensitive, threads).size();
+            } else {
+                for (const QEmuStringView &view : views)
+                    found += view.contains(QEmuStringView(u"locale/file_12"));
+            }
+            doNotOptimize(found);
+        } else {
+            QVector<QEmuStringView> work = views;
+            if (threads) {
+                if (operation == BulkSort)
+                    QEmuParallel::sort(work, threads);
+                else
+                    QEmuParallel::dedup(work, threads);
+            } else {
+                std::sort(work.begin(), work.end());
+                if (operation == BulkDedup)
+                    work.erase(std::unique(work.begin(), work.end()), work.end());
+            }
+            doNotOptimize(work.size());
+        }
+    }
+}
+
+void tst_bench_QStringView::readLogFile_data() const
+{
+    QTest::addColumn<int>("implementation");
+
+    QTest::newRow("QEmuMappedStringView") << int(Emulated);
+    QTest::newRow("QFile::readAll") << int(PlainQString);
+}
+
+void tst_bench_QStringView::readLogFile() const
+{
+    QFETCH(int, implementation);
+    // 100000 lines, 8 MB
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    const std::u16string line = serialisedText(40) + u"\n";
+    QByteArray chunk;
+    for (int i = 0; i < 1000; ++i)
+        chunk.append(reinterpret_cast<const char *>(line.data()), int(line.size() * sizeof(char16_t)));
+    for (int i = 0; i < 100; ++i)
+        file.write(chunk);
+    file.flush();
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        qsizetype total = 0;
+        if (implementation == Emulated) {
+            const QEmuMappedStringView mapped(file.fileName());
+            for (QEmuStringView l : mapped.lines())
+                total += l.size();
+        } else {
+            QFile in(file.fileName());
+            in.open(QIODevice::ReadOnly);
+            const QByteArray bytes = in.readAll();
+            const QString text = QString::fromUtf16(reinterpret_cast<const ushort *>(bytes.constData()), bytes.size() / 2);
+            for (QEmuStringView l : QEmuStringLines(text))
+                total += l.size();
+        }
+        doNotOptimize(total);
+    }
+}
+
+void tst_bench_QStringView::readRecords_data() const
+{
+    QTest::addColumn<int>("implementation");
+
+    QTest::newRow("QEmuRecordReader") << int(Emulated);
+    QTest::newRow("readLine+fromUtf8") << int(PlainQString);
+}
+
+void tst_bench_QStringView::readRecords() const
+{
+    QFETCH(int, implementation);
+    // 100000 lines, 4 MB
+    const QByteArray line = QEmuStringView(serialisedText(40)).toUtf8() + '\n';
+    QByteArray input;
+    for (int i = 0; i < 100000; ++i)
+        input.append(line.constData(), line.size());
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        QBuffer device(&input);
+        device.open(QIODevice::ReadOnly);
+        qsizetype total = 0;
+        if (implementation == Emulated) {
+            QEmuRecordReader reader(&device);
+            for (QEmuStringView record : reader)
+                total += record.size();
+        } else {
+            while (!device.atEnd()) {
+                const QString record = QString::fromUtf8(device.readLine());
+                total += record.size();
+            }
+        }
+        doNotOptimize(total);
+    }
+}
+
+void tst_bench_QStringView::buildResponse_data() const
+{
+    QTest::addColumn<int>("method");
+
+    QTest::newRow("QEmuStringBuilder") << int(BuildWithBuilder);
+    QTest::newRow("operator%") << int(BuildWithPercent);
+    QTest::newRow("QString+=toString()") << int(BuildWithAppend);
+}
+
+void tst_bench_QStringView::buildResponse() const
+{
+    QFETCH(int, method);
+    const std::u16string text = serialisedText(256);
+    const QEmuStringView source(text.data(), qsizetype(text.size()));
+    // eight fields of a template, each between a Latin-1 label and a separator
+    QEmuStringView fields[8];
+    for (int i = 0; i < 8; ++i)
+        fields[i] = source.mid(i * 32, 24);
+    const QLatin1String label("<td class=\"value\">");
+    const QLatin1String separator("</td>\n");
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        QString result;
+        if (method == BuildWithBuilder) {
+            QEmuStringBuilder builder;
+            for (const QEmuStringView &field : fields)
+                builder << label << field << separator;
+            result = builder.toString();
+        } else if (method == BuildWithPercent) {
+            result = label % fields[0] % separator % label % fields[1] % separator
+                    % label % fields[2] % separator % label % fields[3] % separator
+                    % label % fields[4] % separator % label % fields[5] % separator
+                    % label % fields[6] % separator % label % fields[7] % separator;
+        } else {
+            for (const QEmuStringView &field : fields) {
+                result += label;
+                result += field.toString();
+                result += separator;
+            }
+        }
+        doNotOptimize(result);
+    }
+}
+
+typedef qsizetype (*QustrlenFunction)(const ushort *);
+
+struct QustrlenImplementation {
+    const char *name;
+    QustrlenFunction function;
+    bool supported;
+};
+
+static QVector<QustrlenImplementation> qustrlenImplementations()
+{
+    QVector<QustrlenImplementation> result;
+    result.append({"dispatched", QEmuPrivate::qustrlen, true});
+    result.append({"generic", QEmuPrivate::qustrlen_generic, true});
+#ifdef __SSE2__
+    result.append({"sse2", QEmuPrivate::qustrlen_sse2, true});
+#endif
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    result.append({"avx2", QEmuPrivate::qustrlen_avx2, QEmuPrivate::cpuHasAvx2()});
+    result.append({"avx512", QEmuPrivate::qustrlen_avx512, QEmuPrivate::cpuHasAvx512bw()});
+#endif
+    return result;
+}
+
+void tst_bench_QStringView::qustrlen_data() const
+{
+    QTest::addColumn<int>("implementation");
+    QTest::addColumn<int>("length");
+    QTest::addColumn<int>("offset");
+
+    const QVector<QustrlenImplementation> impls = qustrlenImplementations();
+    for (int i = 0; i < impls.size(); ++i) {
+        for (int length : {1, 15, 64, 1000, 100000}) {
+            // offsets in code units from a 64-byte boundary
+            for (int offset : {0, 1, 7, 31}) {
+                const QByteArray tag = QByteArray(impls.at(i).name) + '/' + QByteArray::number(length)
+                        + "/+" + QByteArray::number(offset);
+                QTest::newRow(tag.constData()) << i << length << offset;
+            }
+        }
+    }
+}
+
+void tst_bench_QStringView::qustrlen() const
+{
+    QFETCH(int, implementation);
+    QFETCH(int, length);
+    QFETCH(int, offset);
+
+    const QustrlenImplementation impl = qustrlenImplementations().at(implementation);
+    if (!impl.supported)
+        QSKIP("not supported by this CPU");
+
+    // 64-byte aligned storage with room for the offset and the terminator
+    std::vector<ushort> storage(length + offset + 64, ushort('x'));
+    ushort *base = storage.data();
+    while (quintptr(base) & 0x3f)
+        ++base;
+    ushort *str = base + offset;
+    str[length] = 0;
+
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        const qsizetype result = impl.function(str);
+        doNotOptimize(result);
+    }
+}
+
+void tst_bench_QStringView::toPrettyUnicode_data() const
+{
+    QTest::addColumn<QString>("string");
+    QTest::addColumn<int>("target");
+
+    QString escapes;
+    for (int i = 0; i < 100; ++i)
+        escapes += QString::fromUtf16(reinterpret_cast<const ushort *>(u"a\né"));
+    const struct {
+        const char *name;
+        QString string;
+    } strings[] = {
+        { "short", QString::fromLatin1("Hello, World!") },
+        { "long-printable", QString(300, QLatin1Char('x')) },
+        { "long-escapes", escapes },
+    };
+    for (const auto &s : strings) {
+        QTest::newRow(s.name) << s.string << int(PrettyNew);
+        QTest::newRow(QByteArray(QByteArray(s.name) + "/buffer").constData()) << s.string << int(PrettyBuffer);
+        QTest::newRow(QByteArray(QByteArray(s.name) + "/QByteArray").constData()) << s.string << int(PrettyByteArray);
+    }
+}
+
+void tst_bench_QStringView::toPrettyUnicode() const
+{
+    QFETCH(QString, string);
+    QFETCH(int, target);
+
+    const QEmuStringView v(string);
+    char buffer[256];
+    QByteArray out;
+    Measurement m;
+    QBENCHMARK {
+        m.tick();
+        if (target == PrettyNew) {
+            delete[] v.toPrettyUnicode();
+        } else if (target == PrettyBuffer) {
+            doNotOptimize(v.toPrettyUnicode(buffer, sizeof(buffer)));
+        } else {
+            v.toPrettyUnicode(out);
+            doNotOptimize(out);
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(tst_bench_QStringView)
+#include "bench_qstringview.moc"
@@ -0,0 +1,11 @@
+TARGET = bench_qstringview
+## uncomment to benchmark the zero-copy mode of QEmuStringView:
+# DEFINES += QEMUSTRINGVIEW_ZEROCOPY
+## or, in the QString-based mode, to keep strings of up to 15 code units inside the view:
+# DEFINES += QEMUSTRINGVIEW_SSO
+QT = core testlib
+contains(QT_CONFIG, c++14):CONFIG *= c++14
+contains(QT_CONFIG, c++1z):CONFIG *= c++1z
+CONFIG += release
+SOURCES += bench_qstringview.cpp
+HEADERS += qemustringview.h qemustringviewalgorithms.h qemumappedstringview.h qemurecordreader.h allocationcounter.h
@@ -0,0 +1,271 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 René J.V. Bertin <gmail:rjvbertin>
+** Contact: gmail:rjvbertin
+**
+** This file is an extension for the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QEMUMAPPEDSTRINGVIEW_H
+#define QEMUMAPPEDSTRINGVIEW_H
+
+#include "qemustringview.h"
+
+#include <QFile>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+/*
+  The lines of a view, as views: split on '\n', with a '\r' before it dropped too.
+  Text after the last line feed is a line of its own, but there is no empty line
+  after a final line feed, so "a\nb\n" has the two lines "a" and "b", like
+  QTextStream::readLine() returns them. Line feeds are found with the same SIMD
+  search as indexOf(QChar).
+*/
+class QEmuStringLines
+{
+public:
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef QEmuStringView value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const QEmuStringView *pointer;
+        typedef const QEmuStringView &reference;
+
+        const_iterator() Q_DECL_NOTHROW : m_lines(nullptr), m_next(-1) {}
+
+        reference operator*() const { return m_line; }
+        pointer operator->() const { return &m_line; }
+
+        const_iterator &operator++() { advance(); return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; advance(); return old; }
+
+        friend bool operator==(const const_iterator &lhs, const const_iterator &rhs) Q_DECL_NOTHROW
+        { return lhs.m_next == rhs.m_next; }
+        friend bool operator!=(const const_iterator &lhs, const const_iterator &rhs) Q_DECL_NOTHROW
+        { return !(lhs == rhs); }
+
+    private:
+        friend class QEmuStringLines;
+
+        explicit const_iterator(const QEmuStringLines *lines)
+            : m_lines(lines), m_next(0)
+        { advance(); }
+
+        void advance()
+        {
+            const QEmuStringView &text = m_lines->m_text;
+            const qsizetype start = m_next;
+            if (start < 0 || start >= text.size()) {
+                // past the last line, or past the line feed that ended it
+                m_next = -1;
+                m_line = QEmuStringView();
+                return;
+            }
+            const ushort *data = reinterpret_cast<const ushort *>(text.constData());
+            qsizetype end = QEmuPrivate::findChar(data, text.size(), start, '\n', Qt::CaseSensitive);
+            if (end < 0) {
+                end = text.size();
+                m_next = end;
+            } else {
+                m_next = end + 1;
+            }
+            if (end > start && data[end - 1] == '\r')
+                --end;
+            m_line = text.mid(start, end - start);
+        }
+
+        const QEmuStringLines *m_lines;
+        QEmuStringView m_line;
+        qsizetype m_next;       // where the line after m_line starts, -1 at the end
+    };
+    typedef const_iterator iterator;
+    typedef QEmuStringView value_type;
+
+    explicit QEmuStringLines(QEmuStringViewArg text) Q_DECL_NOTHROW
+        : m_text(text)
+    {}
+
+    const_iterator begin() const { return const_iterator(this); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator end() const Q_DECL_NOTHROW { return const_iterator(); }
+    const_iterator cend() const Q_DECL_NOTHROW { return end(); }
+
+private:
+    QEmuStringView m_text;
+};
+
+/*
+  A UTF-16 file mapped into memory and exposed as a QEmuStringView, without reading
+  or converting it: open() maps the file, view() is its text, and lines() iterates
+  over that without copying a line. The file must be in the host's byte order; a
+  byte order mark is skipped, one for the other byte order is an error, as is an odd
+  size. The view and every view taken from it are valid until close() or the
+  destruction of the QEmuMappedStringView.
+
+  On Unix, open() tells the kernel how the mapping is going to be read (sequentially
+  by default, so that it reads ahead and drops pages behind); advise() changes that.
+
+  In the QString-based mode the view is a QString::fromRawData() onto the mapping,
+  which limits files to 2^31 - 1 code units; the zero-copy mode has no such limit.
+*/
+class QEmuMappedStringView
+{
+public:
+    enum AccessPattern {
+        NormalAccess,
+        SequentialAccess,
+        RandomAccess
+    };
+
+    QEmuMappedStringView() Q_DECL_NOTHROW
+        : m_map(nullptr), m_text(nullptr), m_size(0), m_hasByteOrderMark(false)
+    {}
+    explicit QEmuMappedStringView(const QString &fileName, AccessPattern pattern = SequentialAccess)
+        : QEmuMappedStringView()
+    {
+        open(fileName, pattern);
+    }
+    ~QEmuMappedStringView()
+    {
+        close();
+    }
+
+    bool open(const QString &fileName, AccessPattern pattern = SequentialAccess)
+    {
+        close();
+        m_error.clear();
+        m_file.setFileName(fileName);
+        if (!m_file.open(QIODevice::ReadOnly))
+            return fail(m_file.errorString());
+        const qint64 bytes = m_file.size();
+        if (bytes % 2)
+            return fail(QStringLiteral("the file size is odd, so the file is not UTF-16"));
+        if (bytes / 2 > qint64(std::numeric_limits<qsizetype>::max()))
+            return fail(QStringLiteral("the file is too large to map"));
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+        if (bytes / 2 > qint64(std::numeric_limits<int>::max()))
+            return fail(QStringLiteral("the file is too large for a QString-based view"));
+#endif
+        if (bytes == 0) {
+            // nothing to map, but still a file that was opened
+            static const ushort empty = 0;
+            m_text = &empty;
+            return true;
+        }
+        m_map = m_file.map(0, bytes);
+        if (!m_map)
+            return fail(m_file.errorString());
+        // a mapping starts on a page boundary, but better safe than misaligned
+        if (quintptr(m_map) % sizeof(ushort))
+            return fail(QStringLiteral("the mapping is not aligned for UTF-16"));
+
+        m_text = reinterpret_cast<const ushort *>(m_map);
+        m_size = qsizetype(bytes / 2);
+        if (m_text[0] == 0xfeff) {
+            m_hasByteOrderMark = true;
+            ++m_text;
+            --m_size;
+        } else if (m_text[0] == 0xfffe) {
+            return fail(QStringLiteral("the file is UTF-16 in the other byte order"));
+        }
+        advise(pattern);
+        return true;
+    }
+
+    void close()
+    {
+        if (m_map)
+            m_file.unmap(m_map);
+        if (m_file.isOpen())
+            m_file.close();
+        m_map = nullptr;
+        m_text = nullptr;
+        m_size = 0;
+        m_hasByteOrderMark = false;
+    }
+
+    bool isOpen() const Q_DECL_NOTHROW { return m_text != nullptr; }
+    // why the last open() failed
+    QString errorString() const { return m_error; }
+    bool hasByteOrderMark() const Q_DECL_NOTHROW { return m_hasByteOrderMark; }
+
+    // the text of the file, after any byte order mark; null if no file is open
+    QEmuStringView view() const
+    {
+        return QEmuStringView(reinterpret_cast<const QChar *>(m_text), m_size,
+                              QEmuPrivate::SiteTag<QEmuPrivate::SiteDecode>());
+    }
+    qsizetype size() const Q_DECL_NOTHROW { return m_size; }
+    QEmuStringLines lines() const { return QEmuStringLines(view()); }
+
+    // Tells the kernel how the mapping is going to be read; only does something on Unix.
+    bool advise(AccessPattern pattern) const Q_DECL_NOTHROW
+    {
+#ifdef Q_OS_UNIX
+        if (!m_map)
+            return false;
+        const int advice = pattern == SequentialAccess ? MADV_SEQUENTIAL
+                         : pattern == RandomAccess ? MADV_RANDOM : MADV_NORMAL;
+        const size_t bytes = size_t(m_size + m_hasByteOrderMark) * sizeof(ushort);
+        return ::madvise(m_map, bytes, advice) == 0;
+#else
+        Q_UNUSED(pattern);
+        return false;
+#endif
+    }
+
+private:
+    Q_DISABLE_COPY(QEmuMappedStringView)
+
+    bool fail(const QString &error)
+    {
+        close();
+        m_error = m_file.fileName() + QStringLiteral(": ") + error;
+        return false;
+    }
+
+    QFile m_file;
+    uchar *m_map;
+    const ushort *m_text;
+    qsizetype m_size;
+    QString m_error;
+    bool m_hasByteOrderMark;
+};
+
+#endif // QEMUMAPPEDSTRINGVIEW_H
@@ -0,0 +1,386 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 René J.V. Bertin <gmail:rjvbertin>
+** Contact: gmail:rjvbertin
+**
+** This file is an extension for the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QEMURECORDREADER_H
+#define QEMURECORDREADER_H
+
+#include "qemustringview.h"
+
+#include <QIODevice>
+
+#include <cerrno>
+#include <climits>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/*
+  Reads records, separated by a delimiter character, from a QIODevice or a file
+  descriptor, and returns them as QEmuStringViews onto a ring buffer of a fixed
+  number of code units, so that an unbounded stream is processed in constant
+  memory. The input is UTF-8 (decoded into the ring as it is read, like
+  QString::fromUtf8() would) or UTF-16 in the host's byte order (read straight
+  into the ring); a leading byte order mark is skipped either way.
+
+  A record is a view onto the ring wherever it can be, which is unless it runs
+  past the end of the ring and continues at its start. Such records, and those
+  that do not fit in the ring at all, are copied into a buffer of their own;
+  copiedRecords() counts them. Either way a record is valid until the next call
+  to readRecord(). The delimiter is searched for with the same SIMD kernel as
+  indexOf(QChar), and every code unit is looked at only once.
+
+  Like QEmuStringLines, the reader returns the text after the last delimiter as a
+  record of its own, but no empty record after a final delimiter. readRecord()
+  returns a null view once the input is exhausted, or on a read error (see
+  hasError()). On sequential devices it blocks in waitForReadyRead() while there
+  is nothing to read.
+*/
+class QEmuRecordReader
+{
+public:
+    enum Encoding {
+        Utf8,
+        Utf16
+    };
+    enum {
+        // in code units
+        DefaultCapacity = 64 * 1024,
+        MinimumCapacity = 64,
+        // bytes of UTF-8 decoded at a time
+        ReadChunk = 16 * 1024
+    };
+
+    class const_iterator
+    {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef QEmuStringView value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const QEmuStringView *pointer;
+        typedef const QEmuStringView &reference;
+
+        const_iterator() Q_DECL_NOTHROW : m_reader(nullptr) {}
+
+        reference operator*() const { return m_record; }
+        pointer operator->() const { return &m_record; }
+        const_iterator &operator++() { advance(); return *this; }
+
+        friend bool operator==(const const_iterator &lhs, const const_iterator &rhs) Q_DECL_NOTHROW
+        { return lhs.m_reader == rhs.m_reader; }
+        friend bool operator!=(const const_iterator &lhs, const const_iterator &rhs) Q_DECL_NOTHROW
+        { return !(lhs == rhs); }
+
+    private:
+        friend class QEmuRecordReader;
+
+        explicit const_iterator(QEmuRecordReader *reader)
+            : m_reader(reader)
+        { advance(); }
+
+        void advance()
+        {
+            m_record = m_reader->readRecord();
+            if (m_record.isNull())
+                m_reader = nullptr;
+        }
+
+        QEmuRecordReader *m_reader;
+        QEmuStringView m_record;
+    };
+    typedef const_iterator iterator;
+    typedef QEmuStringView value_type;
+
+    explicit QEmuRecordReader(QIODevice *device, QChar delimiter = QLatin1Char('\n'), Encoding encoding = Utf8,
+                              qsizetype capacity = DefaultCapacity)
+        : QEmuRecordReader(device, -1, delimiter, encoding, capacity)
+    {}
+    // reads from fd, which the reader does not close
+    explicit QEmuRecordReader(int fd, QChar delimiter = QLatin1Char('\n'), Encoding encoding = Utf8,
+                              qsizetype capacity = DefaultCapacity)
+        : QEmuRecordReader(nullptr, fd, delimiter, encoding, capacity)
+    {}
+
+    // The next record, without its delimiter, or a null view at the end of the input.
+    QEmuStringView readRecord()
+    {
+        m_copy.resize(0);
+        for (;;) {
+            // look for the delimiter where nobody has yet, a contiguous part of the ring at a time
+            while (m_searched < m_end) {
+                const qsizetype at = index(m_searched);
+                const qsizetype len = qsizetype(qMin(m_end - m_searched, qint64(m_capacity - at)));
+                const qsizetype found = QEmuPrivate::findChar(m_ring.data() + at, len, 0, m_delimiter, Qt::CaseSensitive);
+                if (found >= 0)
+                    return take(m_searched + found, 1);
+                m_searched += len;
+            }
+            if (m_atEnd) {
+                if (m_begin < m_end || !m_copy.isEmpty())
+                    return take(m_end, 0);
+                return QEmuStringView();
+            }
+            if (m_capacity - (m_end - m_begin) < MinimumRoom) {
+                // a record longer than the ring: move what there is of it out of the way
+                copy(m_begin, m_end);
+                m_begin = m_end;
+            }
+            fill();
+        }
+    }
+
+    const_iterator begin() { return const_iterator(this); }
+    const_iterator end() Q_DECL_NOTHROW { return const_iterator(); }
+
+    // whether readRecord() has read all of the input
+    bool atEnd() const Q_DECL_NOTHROW { return m_atEnd && m_begin == m_end; }
+    bool hasError() const Q_DECL_NOTHROW { return !m_error.isEmpty(); }
+    QString errorString() const { return m_error; }
+    qsizetype capacity() const Q_DECL_NOTHROW { return m_capacity; }
+    // how many records were not views onto the ring
+    qint64 copiedRecords() const Q_DECL_NOTHROW { return m_copiedRecords; }
+
+private:
+    Q_DISABLE_COPY(QEmuRecordReader)
+
+    enum {
+        // what fill() needs to make progress: a UTF-8 sequence split between two reads
+        // has up to 3 bytes waiting, which decode to no more than 3 code units
+        MinimumRoom = 4
+    };
+
+    QEmuRecordReader(QIODevice *device, int fd, QChar delimiter, Encoding encoding, qsizetype capacity)
+        : m_device(device)
+        , m_fd(fd)
+        , m_delimiter(delimiter.unicode())
+        , m_encoding(encoding)
+        , m_capacity(qMax(capacity, qsizetype(MinimumCapacity)))
+        , m_ring(int(m_capacity))
+        , m_begin(0)
+        , m_searched(0)
+        , m_end(0)
+        , m_copiedRecords(0)
+        , m_pending(0)
+        , m_atEnd(false)
+        , m_atStart(true)
+    {
+        if (m_encoding == Utf8) {
+            m_bytes.resize(ReadChunk + MinimumRoom);
+            m_decoded.resize(ReadChunk + MinimumRoom);
+        }
+    }
+
+    qsizetype index(qint64 pos) const Q_DECL_NOTHROW { return qsizetype(pos % m_capacity); }
+
+    QEmuStringView view(const ushort *data, qsizetype len) const
+    {
+        return QEmuStringView(reinterpret_cast<const QChar *>(data), len,
+                              QEmuPrivate::SiteTag<QEmuPrivate::SiteDecode>());
+    }
+
+    // the record that ends at end, followed by a delimiter of delimiterSize
+    QEmuStringView take(qint64 end, int delimiterSize)
+    {
+        const qint64 begin = m_begin;
+        m_begin = m_searched = end + delimiterSize;
+        const qsizetype at = index(begin);
+        const qsizetype len = qsizetype(end - begin);
+        if (m_copy.isEmpty() && at + len <= m_capacity)
+            return view(m_ring.constData() + at, len);
+        copy(begin, end);
+        ++m_copiedRecords;
+        return view(m_copy.constData(), m_copy.size());
+    }
+
+    // appends [begin, end) of the ring to m_copy
+    void copy(qint64 begin, qint64 end)
+    {
+        const qsizetype at = index(begin);
+        const qsizetype len = qsizetype(end - begin);
+        const qsizetype first = qMin(len, m_capacity - at);
+        m_copy.append(m_ring.constData() + at, int(first));
+        m_copy.append(m_ring.constData(), int(len - first));
+    }
+
+    // Reads what fits into the ring after m_end; sets m_atEnd at the end of the input.
+    void fill()
+    {
+        if (m_encoding == Utf16)
+            fillUtf16();
+        else
+            fillUtf8();
+    }
+
+    // straight into the ring; m_pending is 1 while half a code unit has been read
+    void fillUtf16()
+    {
+        const qsizetype at = index(m_end);
+        const qsizetype room = qMin(m_capacity - qsizetype(m_end - m_begin), m_capacity - at);
+        const qint64 read = readBytes(reinterpret_cast<char *>(m_ring.data() + at) + m_pending,
+                                      qint64(room) * 2 - m_pending);
+        if (read <= 0) {
+            if (m_pending && read == 0)
+                fail(QStringLiteral("the input ends in the middle of a code unit"));
+            m_atEnd = true;
+            return;
+        }
+        const qint64 bytes = read + m_pending;
+        m_end += bytes / 2;
+        m_pending = int(bytes % 2);
+        if (m_atStart && m_end > 0) {
+            m_atStart = false;
+            if (m_ring[0] == 0xfeff) {
+                m_begin = m_searched = 1;
+            } else if (m_ring[0] == 0xfffe) {
+                fail(QStringLiteral("the input is UTF-16 in the other byte order"));
+                m_begin = m_searched = m_end;
+            }
+        }
+    }
+
+    // into m_decoded, and from there into the ring; m_pending bytes of a sequence that
+    // the last read split wait at the start of m_bytes
+    void fillUtf8()
+    {
+        const qsizetype room = m_capacity - qsizetype(m_end - m_begin);
+        const qint64 read = readBytes(m_bytes.data() + m_pending, qMin(qint64(room - m_pending), qint64(ReadChunk)));
+        if (read < 0)
+            m_atEnd = true;
+        const qsizetype len = m_pending + qsizetype(qMax(read, qint64(0)));
+        // decode everything at the end of the input, even an incomplete sequence
+        const qsizetype complete = read > 0 ? completeUtf8(reinterpret_cast<const uchar *>(m_bytes.constData()), len) : len;
+        const uchar *src = reinterpret_cast<const uchar *>(m_bytes.constData());
+        ushort *dst = m_decoded.data();
+        qsizetype i = 0;
+        // utf8ToUtf16() skips a byte order mark, which is only right at the start
+        for ( ; !m_atStart && i + 3 <= complete && src[i] == 0xef && src[i + 1] == 0xbb && src[i + 2] == 0xbf; i += 3)
+            *dst++ = 0xfeff;
+        dst += QEmuPrivate::utf8ToUtf16(src + i, complete - i, dst);
+        store(m_decoded.constData(), qsizetype(dst - m_decoded.constData()));
+        // completeUtf8() keeps sequences whole, so utf8ToUtf16() saw all of a byte order
+        // mark the first time it had anything to decode
+        if (complete > 0)
+            m_atStart = false;
+
+        m_pending = int(len - complete);
+        std::memmove(m_bytes.data(), m_bytes.constData() + complete, size_t(m_pending));
+        if (read == 0)
+            m_atEnd = true;
+    }
+
+    // where the last, possibly incomplete, UTF-8 sequence in [src, src + len) starts,
+    // or len if it is complete
+    static qsizetype completeUtf8(const uchar *src, qsizetype len) Q_DECL_NOTHROW
+    {
+        for (qsizetype i = len - 1; i >= 0 && i >= len - 3; --i) {
+            if ((src[i] & 0xc0) == 0x80)
+                continue;
+            const int needed = src[i] >= 0xf0 ? 4 : src[i] >= 0xe0 ? 3 : src[i] >= 0xc0 ? 2 : 1;
+            return i + needed > len ? i : len;
+        }
+        return len;
+    }
+
+    // appends [src, src + len) to the ring, which has room for it
+    void store(const ushort *src, qsizetype len)
+    {
+        const qsizetype at = index(m_end);
+        const qsizetype first = qMin(len, m_capacity - at);
+        std::memcpy(m_ring.data() + at, src, size_t(first) * sizeof(ushort));
+        std::memcpy(m_ring.data(), src + first, size_t(len - first) * sizeof(ushort));
+        m_end += len;
+    }
+
+    // -1 on errors, 0 at the end of the input
+    qint64 readBytes(char *dst, qint64 maxSize)
+    {
+        if (m_device) {
+            for (;;) {
+                const qint64 read = m_device->read(dst, maxSize);
+                if (read < 0)
+                    fail(m_device->errorString());
+                // a sequential device may just have nothing to read yet
+                if (read != 0 || !m_device->waitForReadyRead(-1))
+                    return read;
+            }
+        }
+        for (;;) {
+#ifdef Q_OS_WIN
+            const qint64 read = ::_read(m_fd, dst, unsigned(qMin(maxSize, qint64(INT_MAX))));
+#else
+            const qint64 read = ::read(m_fd, dst, size_t(maxSize));
+#endif
+            if (read >= 0)
+                return read;
+            if (errno != EINTR) {
+                fail(QString::fromLocal8Bit(strerror(errno)));
+                return -1;
+            }
+        }
+    }
+
+    void fail(const QString &error)
+    {
+        m_error = error;
+        m_atEnd = true;
+    }
+
+    QIODevice *m_device;
+    const int m_fd;
+    const ushort m_delimiter;
+    const Encoding m_encoding;
+    const qsizetype m_capacity;
+    QVarLengthArray<ushort, 1> m_ring;
+    // positions in the input, in code units: the next record starts at m_begin, the
+    // ring holds everything up to m_end, and there is no delimiter before m_searched
+    qint64 m_begin;
+    qint64 m_searched;
+    qint64 m_end;
+    QVarLengthArray<ushort, 256> m_copy;
+    qint64 m_copiedRecords;
+    QVarLengthArray<char, 1> m_bytes;
+    QVarLengthArray<ushort, 1> m_decoded;
+    int m_pending;
+    bool m_atEnd;
+    bool m_atStart;
+    QString m_error;
+};
+
+#endif // QEMURECORDREADER_H
@@ -44,6 +44,17 @@
 #define QEMUSTRINGVIEW_H
 
 #include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QStringBuilder>
+#include <QVector>
+#include <QVarLengthArray>
+#include <QMutex>
+#ifndef QT_NO_TEXTCODEC
+#include <QTextCodec>
+#endif
+#include <QDebug>
 class QStringView;
 
 #if defined(QSTRINGVIEW_H) && defined(QSTRINGVIEW_EMULATE)
@@ -55,8 +66,29 @@ class QStringView;
 #ifdef __SSE2__
 #include <immintrin.h>
 #endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
 #include <qalgorithms.h>
 #include <qglobal.h>
+#include <atomic>
+#ifdef QEMUSTRINGVIEW_INSTRUMENT
+#include <cstdio>
+#include <cstdlib>
+#endif
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#  if __has_include(<charconv>)
+#    include <charconv>
+#    if defined(__cpp_lib_to_chars)
+#      define QEMUSTRINGVIEW_HAVE_FROM_CHARS
+#    endif
+#  endif
+#endif
 
 #if !defined(Q_ASSERT10)
 #  if defined(QT_NO_DEBUG) && !defined(QT_FORCE_ASSERTS)
@@ -66,6 +98,26 @@ class QStringView;
 #  endif
 #endif
 
+// runtime selection of the AVX2 and AVX-512 kernels, where the compiler lets us
+// build them without enabling those instruction sets for the whole translation unit
+#if defined(__SSE2__) && defined(Q_PROCESSOR_X86) && !defined(QEMUSTRINGVIEW_NO_CPU_DISPATCH) \
+    && (defined(Q_CC_CLANG) || (defined(Q_CC_GNU) && Q_CC_GNU >= 600)) && !defined(Q_CC_INTEL)
+#  define QEMUSTRINGVIEW_CPU_DISPATCH
+#  define QEMUSTRINGVIEW_FUNCTION_TARGET(x) __attribute__((__target__(x)))
+#endif
+
+// lets the comparison operators run a plain loop during constant evaluation and
+// the SIMD kernels otherwise
+#if defined(__cpp_lib_is_constant_evaluated)
+#  define QEMUSTRINGVIEW_IS_CONSTANT_EVALUATED() std::is_constant_evaluated()
+#elif defined(__has_builtin)
+#  if __has_builtin(__builtin_is_constant_evaluated)
+#    define QEMUSTRINGVIEW_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#  endif
+#elif (defined(Q_CC_GNU) && !defined(Q_CC_CLANG) && Q_CC_GNU >= 900) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#  define QEMUSTRINGVIEW_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+
 /*
   quintptr and qptrdiff is guaranteed to be the same size as a pointer, i.e.
 
@@ -124,9 +176,9 @@ namespace QEmuPrivate {
             typename std::remove_cv<typename std::remove_reference<T>::type>::type
           > {};
 
-    qsizetype qustrlen(const ushort *str) Q_DECL_NOTHROW
-    {
 #ifdef __SSE2__
+    inline qsizetype qustrlen_sse2(const ushort *str) Q_DECL_NOTHROW
+    {
         // find the 16-byte alignment immediately prior or equal to str
         quintptr misalignment = quintptr(str) & 0xf;
         Q_ASSERT((misalignment & 1) == 0);
@@ -158,7 +210,78 @@ namespace QEmuPrivate {
         // found a null
         uint idx = qCountTrailingZeroBits(quint32(mask));
         return ptr - str + idx / 2;
-#else
+    }
+#endif
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    // Same approach as qustrlen_sse2(), with 32- and 64-byte aligned blocks. Those
+    // can never straddle a page boundary either.
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline qsizetype qustrlen_avx2(const ushort *str) Q_DECL_NOTHROW
+    {
+        const quintptr misalignment = quintptr(str) & 0x1f;
+        Q_ASSERT((misalignment & 1) == 0);
+        const ushort *ptr = str - (misalignment / 2);
+
+        const __m256i zeroes = _mm256_setzero_si256();
+        __m256i data = _mm256_load_si256(reinterpret_cast<const __m256i *>(ptr));
+        quint32 mask = _mm256_movemask_epi8(_mm256_cmpeq_epi16(data, zeroes));
+        mask >>= misalignment;
+        if (mask)
+            return qCountTrailingZeroBits(mask) / 2;
+
+        do {
+            ptr += 16;
+            data = _mm256_load_si256(reinterpret_cast<const __m256i *>(ptr));
+            mask = _mm256_movemask_epi8(_mm256_cmpeq_epi16(data, zeroes));
+        } while (mask == 0);
+
+        return ptr - str + qCountTrailingZeroBits(mask) / 2;
+    }
+
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx512f,avx512bw")
+    inline qsizetype qustrlen_avx512(const ushort *str) Q_DECL_NOTHROW
+    {
+        const quintptr misalignment = quintptr(str) & 0x3f;
+        Q_ASSERT((misalignment & 1) == 0);
+        const ushort *ptr = str - (misalignment / 2);
+
+        // the AVX-512 comparisons produce one mask bit per 16-bit lane
+        const __m512i zeroes = _mm512_setzero_si512();
+        __m512i data = _mm512_load_si512(reinterpret_cast<const void *>(ptr));
+        quint32 mask = _mm512_cmpeq_epi16_mask(data, zeroes);
+        mask >>= misalignment / 2;
+        if (mask)
+            return qCountTrailingZeroBits(mask);
+
+        do {
+            ptr += 32;
+            data = _mm512_load_si512(reinterpret_cast<const void *>(ptr));
+            mask = _mm512_cmpeq_epi16_mask(data, zeroes);
+        } while (mask == 0);
+
+        return ptr - str + qCountTrailingZeroBits(mask);
+    }
+
+    inline bool cpuHasAvx2() Q_DECL_NOTHROW
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+    inline bool cpuHasSse42() Q_DECL_NOTHROW
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2");
+    }
+    inline bool cpuHasAvx512bw() Q_DECL_NOTHROW
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    }
+#endif // QEMUSTRINGVIEW_CPU_DISPATCH
+
+    inline qsizetype qustrlen_generic(const ushort *str) Q_DECL_NOTHROW
+    {
         qsizetype result = 0;
 
         if (sizeof(wchar_t) == sizeof(ushort))
@@ -167,352 +290,3863 @@ namespace QEmuPrivate {
         while (*str++)
             ++result;
         return result;
-#endif
     }
 
-} // namespace QEmuPrivate
-
-class QEmuStringView : public QString
-{
-public:
-    typedef QChar storage_type;
-    typedef const QChar value_type;
-    typedef std::ptrdiff_t difference_type;
-    typedef qsizetype size_type;
-    typedef value_type &reference;
-    typedef value_type &const_reference;
-    typedef value_type *pointer;
-    typedef value_type *const_pointer;
+    typedef qsizetype (*QustrlenFunction)(const ushort *);
 
-    typedef pointer iterator;
-    typedef const_pointer const_iterator;
-    typedef std::reverse_iterator<iterator> reverse_iterator;
-    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+    inline QustrlenFunction resolveQustrlen() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx512bw())
+            return qustrlen_avx512;
+        if (cpuHasAvx2())
+            return qustrlen_avx2;
+#endif
+#ifdef __SSE2__
+        return qustrlen_sse2;
+#else
+        return qustrlen_generic;
+#endif
+    }
 
-    template <typename Char>
-    using if_compatible_char = typename std::enable_if<QEmuPrivate::IsCompatibleCharType<Char>::value, bool>::type;
+    inline qsizetype qustrlen(const ushort *str) Q_DECL_NOTHROW
+    {
+        // the widest implementation the CPU supports, picked on first use
+        static const QustrlenFunction impl = resolveQustrlen();
+        return impl(str);
+    }
 
-    template <typename Array>
-    using if_compatible_array = typename std::enable_if<QEmuPrivate::IsCompatibleArray<Array>::value, bool>::type;
+    // returns the index of the first code unit where a and b differ, or len
+    inline qsizetype ucstrmismatch_generic(const ushort *a, const ushort *b, qsizetype len) Q_DECL_NOTHROW
+    {
+        for (qsizetype i = 0; i < len; ++i) {
+            if (a[i] != b[i])
+                return i;
+        }
+        return len;
+    }
 
-    template <typename Pointer>
-    using if_compatible_pointer = typename std::enable_if<QEmuPrivate::IsCompatiblePointer<Pointer>::value, bool>::type;
+#ifdef __SSE2__
+    inline qsizetype ucstrmismatch_sse2(const ushort *a, const ushort *b, qsizetype len) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i da = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+            const __m128i db = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+            const quint32 mask = ~quint32(_mm_movemask_epi8(_mm_cmpeq_epi16(da, db))) & 0xffff;
+            if (mask)
+                return i + qCountTrailingZeroBits(mask) / 2;
+        }
+        return i + ucstrmismatch_generic(a + i, b + i, len - i);
+    }
+#endif
 
-    template <typename T>
-    using if_compatible_string = typename std::enable_if<QEmuPrivate::IsCompatibleStdBasicString<T>::value, bool>::type;
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline qsizetype ucstrmismatch_avx2(const ushort *a, const ushort *b, qsizetype len) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+        for ( ; i + 16 <= len; i += 16) {
+            const __m256i da = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            const __m256i db = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+            const quint32 mask = ~quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi16(da, db)));
+            if (mask)
+                return i + qCountTrailingZeroBits(mask) / 2;
+        }
+        return i + ucstrmismatch_sse2(a + i, b + i, len - i);
+    }
+#endif
 
-    template <typename T>
-    using if_compatible_qstring_like = typename std::enable_if<std::is_same<T, QString>::value || std::is_same<T, QStringRef>::value, bool>::type;
+    typedef qsizetype (*UcstrmismatchFunction)(const ushort *, const ushort *, qsizetype);
 
-    template <typename T>
-    using if_compatible_qstringview_like = typename std::enable_if<std::is_same<T, QStringView>::value || std::is_same<T, QEmuStringView>::value, bool>::type;
+    inline UcstrmismatchFunction resolveUcstrmismatch() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return ucstrmismatch_avx2;
+#endif
+#ifdef __SSE2__
+        return ucstrmismatch_sse2;
+#else
+        return ucstrmismatch_generic;
+#endif
+    }
 
-    template <typename Char, size_t N>
-    static Q_DECL_CONSTEXPR qsizetype lengthHelperArray(const Char (&)[N]) Q_DECL_NOTHROW
+    inline qsizetype ucstrmismatch(const ushort *a, const ushort *b, qsizetype len) Q_DECL_NOTHROW
     {
-        return qsizetype(N - 1);
+        static const UcstrmismatchFunction impl = resolveUcstrmismatch();
+        return impl(a, b, len);
     }
 
-    template <typename Char>
-    static qsizetype lengthHelperPointer(const Char *str) Q_DECL_NOTHROW
+    // lexicographic comparison by UTF-16 code unit, like QString::compare()
+    inline int ucstrcmp(const ushort *a, qsizetype alen, const ushort *b, qsizetype blen) Q_DECL_NOTHROW
     {
-        if (!str) {
+        if (a == b && alen == blen)
             return 0;
+        const qsizetype l = qMin(alen, blen);
+        const qsizetype i = ucstrmismatch(a, b, l);
+        if (i < l)
+            return int(a[i]) - int(b[i]);
+        return alen == blen ? 0 : alen < blen ? -1 : 1;
+    }
+
+    inline bool ucstreq(const ushort *a, qsizetype alen, const ushort *b, qsizetype blen) Q_DECL_NOTHROW
+    {
+        return alen == blen && (a == b || ucstrmismatch(a, b, alen) == alen);
+    }
+
+    // index of the first c in [s, s + len), or -1
+#ifdef __SSE2__
+    inline qsizetype qustrchr_sse2(const ushort *s, qsizetype len, ushort c) Q_DECL_NOTHROW
+    {
+        const __m128i needle = _mm_set1_epi16(short(c));
+        qsizetype i = 0;
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const quint32 mask = _mm_movemask_epi8(_mm_cmpeq_epi16(data, needle));
+            if (mask)
+                return i + qCountTrailingZeroBits(mask) / 2;
         }
-#if defined(Q_CC_GNU) && !defined(Q_CC_CLANG) && !defined(Q_CC_INTEL)
-        if (__builtin_constant_p(*str)) {
-            qsizetype result = 0;
-            while (*str++)
-                ++result;
-            return result;
+        for ( ; i < len; ++i) {
+            if (s[i] == c)
+                return i;
         }
+        return -1;
+    }
 #endif
-        return QEmuPrivate::qustrlen(reinterpret_cast<const ushort *>(str));
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline qsizetype qustrchr_avx2(const ushort *s, qsizetype len, ushort c) Q_DECL_NOTHROW
+    {
+        const __m256i needle = _mm256_set1_epi16(short(c));
+        qsizetype i = 0;
+        // two blocks per iteration: the loop is bound by the loads, not by the branch
+        for ( ; i + 32 <= len; i += 32) {
+            const __m256i d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+            const __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i + 16));
+            const __m256i c0 = _mm256_cmpeq_epi16(d0, needle);
+            const __m256i c1 = _mm256_cmpeq_epi16(d1, needle);
+            if (!_mm256_testz_si256(_mm256_or_si256(c0, c1), _mm256_or_si256(c0, c1))) {
+                const quint32 mask = _mm256_movemask_epi8(c0);
+                if (mask)
+                    return i + qCountTrailingZeroBits(mask) / 2;
+                return i + 16 + qCountTrailingZeroBits(quint32(_mm256_movemask_epi8(c1))) / 2;
+            }
+        }
+        for ( ; i + 16 <= len; i += 16) {
+            const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+            const quint32 mask = _mm256_movemask_epi8(_mm256_cmpeq_epi16(data, needle));
+            if (mask)
+                return i + qCountTrailingZeroBits(mask) / 2;
+        }
+        for ( ; i < len; ++i) {
+            if (s[i] == c)
+                return i;
+        }
+        return -1;
     }
-    static qsizetype lengthHelperPointer(const QChar *str) Q_DECL_NOTHROW
+#endif
+
+    inline qsizetype qustrchr_generic(const ushort *s, qsizetype len, ushort c) Q_DECL_NOTHROW
     {
-        return str ? QEmuPrivate::qustrlen(reinterpret_cast<const ushort *>(str)) : 0;
+        for (qsizetype i = 0; i < len; ++i) {
+            if (s[i] == c)
+                return i;
+        }
+        return -1;
     }
 
-    template <typename Char>
-    static const storage_type *castHelper(const Char *str) Q_DECL_NOTHROW
-    { return reinterpret_cast<const storage_type*>(str); }
-    static Q_DECL_CONSTEXPR const storage_type *castHelper(const storage_type *str) Q_DECL_NOTHROW
-    { return str; }
-    template <typename Char>
-    static Q_DECL_CONSTEXPR const storage_type *castHelper(const std::basic_string<Char> str) Q_DECL_NOTHROW
-    { return reinterpret_cast<const storage_type*>(str.data()); }
+    typedef qsizetype (*QustrchrFunction)(const ushort *, qsizetype, ushort);
 
-public:
-    inline QEmuStringView()
-        : QString() {}
-    QEmuStringView(std::nullptr_t) Q_DECL_NOTHROW
-        : QString(), m_isNull(true) {}
-    inline QEmuStringView(const QString &that)
+    inline QustrchrFunction resolveQustrchr() Q_DECL_NOTHROW
     {
-        *this = that;
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return qustrchr_avx2;
+#endif
+#ifdef __SSE2__
+        return qustrchr_sse2;
+#else
+        return qustrchr_generic;
+#endif
     }
-    inline QEmuStringView(const QString *that)
+
+    inline qsizetype qustrchr(const ushort *s, qsizetype len, ushort c) Q_DECL_NOTHROW
     {
-        if (that) {
-            *this = *that;
-        } else {
-            clear();
-            m_isNull = true;
+        static const QustrchrFunction impl = resolveQustrchr();
+        return impl(s, len, c);
+    }
+
+    // index of the last c in [s, s + len), or -1
+    inline qsizetype qustrrchr(const ushort *s, qsizetype len, ushort c) Q_DECL_NOTHROW
+    {
+        qsizetype i = len;
+#ifdef __SSE2__
+        const __m128i needle = _mm_set1_epi16(short(c));
+        for ( ; i >= 8; i -= 8) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i - 8));
+            const quint32 mask = _mm_movemask_epi8(_mm_cmpeq_epi16(data, needle));
+            if (mask)
+                return i - 8 + (31 - qCountLeadingZeroBits(mask)) / 2;
         }
+#endif
+        while (i--) {
+            if (s[i] == c)
+                return i;
+        }
+        return -1;
     }
 
-//     inline QEmuStringView(const QChar *str, qsizetype len=-1)
-//         : QString(str,len) {}
-template <typename Char, if_compatible_char<Char> = true>
-    inline Q_DECL_CONSTEXPR QEmuStringView(const Char *str, qsizetype len)
-        : QString(castHelper(str),len), m_isNull(str==nullptr)
-        , m_hasData(true), m_data(str) {}
-template <typename Char, if_compatible_char<Char> = true>
-    inline Q_DECL_CONSTEXPR QEmuStringView(const Char *f, const Char *l)
-        : QEmuStringView(f, l - f) {}
-template <typename Array, if_compatible_array<Array> = true>
-    Q_DECL_CONSTEXPR QEmuStringView(const Array &str) Q_DECL_NOTHROW
-        : QEmuStringView(str, lengthHelperArray(str)) {}
+    inline qsizetype qustrcount(const ushort *s, qsizetype len, ushort c) Q_DECL_NOTHROW
+    {
+        qsizetype result = 0;
+        qsizetype i = 0;
+#ifdef __SSE2__
+        const __m128i needle = _mm_set1_epi16(short(c));
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            result += qPopulationCount(quint32(_mm_movemask_epi8(_mm_cmpeq_epi16(data, needle)))) / 2;
+        }
+#endif
+        for ( ; i < len; ++i)
+            result += s[i] == c;
+        return result;
+    }
 
-template <typename Pointer, if_compatible_pointer<Pointer> = true>
-    Q_DECL_CONSTEXPR QEmuStringView(const Pointer &str) Q_DECL_NOTHROW
-        : QEmuStringView(str, str ? lengthHelperPointer(str) : 0) {}
+    // Index of the first code unit in [s, s + len) that could equal the ASCII character c
+    // when folded: c in either case, and anything outside ASCII because some of that
+    // folds to ASCII too (U+212A KELVIN SIGN to 'k', for one). Callers verify the hits.
+    inline qsizetype qustrchr_foldCandidate(const ushort *s, qsizetype len, ushort c) Q_DECL_NOTHROW
+    {
+        Q_ASSERT(c < 0x80);
+        const ushort lower = c | 0x20;
+        qsizetype i = 0;
+#ifdef __SSE2__
+        const __m128i needle = _mm_set1_epi16(short(lower));
+        const __m128i caseBit = _mm_set1_epi16(0x20);
+        const __m128i nonAscii = _mm_set1_epi16(short(0xff80));
+        const __m128i zeroes = _mm_setzero_si128();
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const __m128i letter = _mm_cmpeq_epi16(_mm_or_si128(data, caseBit), needle);
+            const __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(data, nonAscii), zeroes);
+            const quint32 mask = _mm_movemask_epi8(_mm_or_si128(letter, _mm_xor_si128(ascii, _mm_cmpeq_epi16(zeroes, zeroes))));
+            if (mask)
+                return i + qCountTrailingZeroBits(mask) / 2;
+        }
+#endif
+        for ( ; i < len; ++i) {
+            if ((s[i] | 0x20) == lower || s[i] >= 0x80)
+                return i;
+        }
+        return -1;
+    }
 
-template <typename String, if_compatible_qstring_like<String> = true>
-    inline Q_DECL_CONSTEXPR QEmuStringView(const String &str) Q_DECL_NOTHROW
-        : QEmuStringView(str.isNull() ? nullptr : str.data(), qsizetype(str.size())) {}
-template <typename StdBasicString, if_compatible_string<StdBasicString> = true>
-    QEmuStringView(const StdBasicString &str) Q_DECL_NOTHROW
-        : QEmuStringView(str.data(), qsizetype(str.size())) {}
+    inline uint foldCase(uint c) Q_DECL_NOTHROW
+    {
+        return QChar::toCaseFolded(c);
+    }
 
-    inline QEmuStringView(const std::wstring str)
-        : QString(QString::fromStdWString(str)) {}
-    inline QEmuStringView(const wchar_t *str)
-        : QString(str ? QString::fromStdWString(str) : nullptr)
-        , m_hasData(true), m_data(str)
+    // The folded form of the code unit at s[i], where a surrogate pair is folded as a
+    // whole, like QString does. Simple case folding never changes the length in UTF-16.
+    inline ushort foldCaseAt(const ushort *s, qsizetype i, qsizetype len) Q_DECL_NOTHROW
     {
-        if (!str) {
-            m_isNull = true;
-        }
+        const ushort c = s[i];
+        if (QChar::isHighSurrogate(c) && i + 1 < len && QChar::isLowSurrogate(s[i + 1]))
+            return QChar::highSurrogate(foldCase(QChar::surrogateToUcs4(c, s[i + 1])));
+        if (QChar::isLowSurrogate(c) && i > 0 && QChar::isHighSurrogate(s[i - 1]))
+            return QChar::lowSurrogate(foldCase(QChar::surrogateToUcs4(s[i - 1], c)));
+        return ushort(foldCase(c));
     }
 
+#ifdef __SSE2__
+    // ASCII-only blocks fold by setting the case bit of the upper-case letters
+    inline __m128i foldAscii_sse2(__m128i data) Q_DECL_NOTHROW
+    {
+        const __m128i upper = _mm_and_si128(_mm_cmpgt_epi16(data, _mm_set1_epi16('A' - 1)),
+                                            _mm_cmpgt_epi16(_mm_set1_epi16('Z' + 1), data));
+        return _mm_or_si128(data, _mm_and_si128(upper, _mm_set1_epi16(0x20)));
+    }
+#endif
 
-    inline bool empty() {return QString::size() == 0 ; }
-    Q_REQUIRED_RESULT inline QChar first() const { return at(0); }
-    Q_REQUIRED_RESULT inline QChar front() const { return at(0); }
-    Q_REQUIRED_RESULT inline QChar last()  const { return at(size() - 1); }
-    Q_REQUIRED_RESULT inline QChar back()  const { return at(size() - 1); }
+    // Case-insensitive ordering, like QString::compare(..., Qt::CaseInsensitive):
+    // the difference of the first pair of folded code units that differ. Blocks of
+    // 8 code units that are ASCII on both sides are folded and compared at once;
+    // only the blocks that are not go through QChar::toCaseFolded().
+    inline int ucstricmp(const ushort *a, qsizetype alen, const ushort *b, qsizetype blen) Q_DECL_NOTHROW
+    {
+        const qsizetype l = qMin(alen, blen);
+        qsizetype i = 0;
+        if (a == b)
+            i = l;
+#ifdef __SSE2__
+        const __m128i nonAscii = _mm_set1_epi16(short(0xff80));
+        const __m128i zeroes = _mm_setzero_si128();
+        for ( ; i + 8 <= l; i += 8) {
+            const __m128i da = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+            const __m128i db = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+            const __m128i high = _mm_and_si128(_mm_or_si128(da, db), nonAscii);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zeroes)) != 0xffff) {
+                for (qsizetype k = i; k < i + 8; ++k) {
+                    const int diff = int(foldCaseAt(a, k, alen)) - int(foldCaseAt(b, k, blen));
+                    if (diff)
+                        return diff;
+                }
+                continue;
+            }
+            const quint32 mask = ~quint32(_mm_movemask_epi8(_mm_cmpeq_epi16(foldAscii_sse2(da), foldAscii_sse2(db)))) & 0xffff;
+            if (mask) {
+                const qsizetype k = i + qCountTrailingZeroBits(mask) / 2;
+                return int(foldCase(a[k])) - int(foldCase(b[k]));
+            }
+        }
+#endif
+        for ( ; i < l; ++i) {
+            const int diff = int(foldCaseAt(a, i, alen)) - int(foldCaseAt(b, i, blen));
+            if (diff)
+                return diff;
+        }
+        return alen == blen ? 0 : alen < blen ? -1 : 1;
+    }
 
-    inline QString toString() const
+    // Case-insensitive equality of two runs of len code units
+    inline bool ucstrieq(const ushort *a, const ushort *b, qsizetype len) Q_DECL_NOTHROW
     {
-        // detour via QStringRef::toString() which makes the required deep copy
-        return QStringRef(this).toString();
+        return ucstricmp(a, len, b, len) == 0;
     }
 
-    inline QEmuStringView &operator=(const QString &other) Q_DECL_NOTHROW
+    inline bool ucstreq(const ushort *a, qsizetype alen, const ushort *b, qsizetype blen, Qt::CaseSensitivity cs) Q_DECL_NOTHROW
     {
-        *(static_cast<QString*>(this)) = other;
-        m_hasData = m_isNull = false;
-        m_data = nullptr;
-        return *this;
+        if (cs == Qt::CaseSensitive)
+            return ucstreq(a, alen, b, blen);
+        return alen == blen && ucstrieq(a, b, alen);
     }
-    inline QEmuStringView &operator=(const QString *other) Q_DECL_NOTHROW
+
+    // Substring search for needles of two or more code units: compare the first and
+    // the last code unit of the needle at 8 positions at once (16 with AVX2), and only look at
+    // the rest of it where both match.
+    inline qsizetype ucstrstr_generic(const ushort *h, qsizetype hlen, const ushort *n, qsizetype nlen) Q_DECL_NOTHROW
     {
-        if (other) {
-            *(static_cast<QString*>(this)) = *other;
-            m_isNull = false;
-        } else {
-            QString::clear();
-            m_isNull = true;
+        const qsizetype starts = hlen - nlen + 1;
+        const qsizetype middle = nlen - 2;
+        for (qsizetype i = 0; i < starts; ++i) {
+            if (h[i] == n[0] && h[i + nlen - 1] == n[nlen - 1] && ucstrmismatch(h + i + 1, n + 1, middle) == middle)
+                return i;
         }
-        m_hasData = false;
-        m_data = nullptr;
-        return *this;
+        return -1;
     }
-    Q_REQUIRED_RESULT const QChar operator[](qsizetype n) const
-    { return Q_ASSERT10(n >= 0), Q_ASSERT10(n < size()), at(n); }
 
-    inline const QChar *unicode() const
+#ifdef __SSE2__
+    inline qsizetype ucstrstr_sse2(const ushort *h, qsizetype hlen, const ushort *n, qsizetype nlen) Q_DECL_NOTHROW
     {
-        return m_isNull ? nullptr : QString::unicode();
+        const qsizetype starts = hlen - nlen + 1;
+        const qsizetype middle = nlen - 2;
+        const __m128i first = _mm_set1_epi16(short(n[0]));
+        const __m128i last = _mm_set1_epi16(short(n[nlen - 1]));
+        qsizetype i = 0;
+        for ( ; i + 8 <= starts; i += 8) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i + nlen - 1));
+            quint32 mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, first), _mm_cmpeq_epi16(b, last)));
+            while (mask) {
+                const qsizetype pos = i + qCountTrailingZeroBits(mask) / 2;
+                if (ucstrmismatch(h + pos + 1, n + 1, middle) == middle)
+                    return pos;
+                // both bits of the lane
+                mask &= mask - 1;
+                mask &= mask - 1;
+            }
+        }
+        const qsizetype rest = ucstrstr_generic(h + i, hlen - i, n, nlen);
+        return rest < 0 ? -1 : i + rest;
     }
-    inline const_pointer data() const
+#endif
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline qsizetype ucstrstr_avx2(const ushort *h, qsizetype hlen, const ushort *n, qsizetype nlen) Q_DECL_NOTHROW
     {
-        return m_isNull ? nullptr :
-            m_hasData ? static_cast<const_pointer>(m_data) : QString::data();
+        const qsizetype starts = hlen - nlen + 1;
+        const qsizetype middle = nlen - 2;
+        const __m256i first = _mm256_set1_epi16(short(n[0]));
+        const __m256i last = _mm256_set1_epi16(short(n[nlen - 1]));
+        qsizetype i = 0;
+        for ( ; i + 16 <= starts; i += 16) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(h + i));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(h + i + nlen - 1));
+            quint32 mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi16(a, first),
+                                                                 _mm256_cmpeq_epi16(b, last)));
+            while (mask) {
+                const qsizetype pos = i + qCountTrailingZeroBits(mask) / 2;
+                if (ucstrmismatch(h + pos + 1, n + 1, middle) == middle)
+                    return pos;
+                mask &= mask - 1;
+                mask &= mask - 1;
+            }
+        }
+        const qsizetype rest = ucstrstr_sse2(h + i, hlen - i, n, nlen);
+        return rest < 0 ? -1 : i + rest;
     }
-    inline QChar *data()
+#endif
+
+    typedef qsizetype (*UcstrstrFunction)(const ushort *, qsizetype, const ushort *, qsizetype);
+
+    inline UcstrstrFunction resolveUcstrstr() Q_DECL_NOTHROW
     {
-        // another nice hack to return a non-const version of m_data...
-        void** pp = const_cast<void**>(&m_data);
-        return m_isNull ? nullptr :
-            m_hasData ? static_cast<QChar*>(*pp) : QString::data();
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return ucstrstr_avx2;
+#endif
+#ifdef __SSE2__
+        return ucstrstr_sse2;
+#else
+        return ucstrstr_generic;
+#endif
     }
-    inline const QChar *constData() const
+
+    inline qsizetype ucstrstr(const ushort *h, qsizetype hlen, const ushort *n, qsizetype nlen) Q_DECL_NOTHROW
     {
-        return m_isNull ? nullptr :
-            m_hasData ? static_cast<const QChar*>(m_data) :QString::constData();
+        Q_ASSERT(nlen >= 2);
+        static const UcstrstrFunction impl = resolveUcstrstr();
+        return impl(h, hlen, n, nlen);
     }
 
-    const ushort *utf16() const
+    // The QString::indexOf() family on (pointer, length) pairs, with the same handling
+    // of negative and out-of-range from positions.
+    inline qsizetype findChar(const ushort *s, qsizetype len, qsizetype from, ushort c, Qt::CaseSensitivity cs) Q_DECL_NOTHROW
     {
-        return (m_isNull || isNull()) ? nullptr : QString::utf16();
+        if (from < 0)
+            from = qMax(from + len, qsizetype(0));
+        if (from >= len)
+            return -1;
+        s += from;
+        len -= from;
+        if (cs == Qt::CaseSensitive) {
+            const qsizetype i = qustrchr(s, len, c);
+            return i < 0 ? -1 : from + i;
+        }
+        const uint folded = foldCase(c);
+        if (c < 0x80) {
+            for (qsizetype i = 0; i < len; ++i) {
+                const qsizetype hit = qustrchr_foldCandidate(s + i, len - i, c);
+                if (hit < 0)
+                    return -1;
+                i += hit;
+                if (foldCase(s[i]) == folded)
+                    return from + i;
+            }
+            return -1;
+        }
+        for (qsizetype i = 0; i < len; ++i) {
+            if (foldCase(s[i]) == folded)
+                return from + i;
+        }
+        return -1;
     }
 
-    char *toPrettyUnicode() const
+    inline qsizetype findString(const ushort *h, qsizetype hlen, qsizetype from,
+                                const ushort *n, qsizetype nlen, Qt::CaseSensitivity cs) Q_DECL_NOTHROW
     {
-        auto p = reinterpret_cast<const ushort *>(utf16());
-        auto length = size();
-        // keep it simple for the vast majority of cases
-        bool trimmed = false;
-        QScopedArrayPointer<char> buffer(new char[256]);
-        const ushort *end = p + length;
-        char *dst = buffer.data();
+        if (from < 0)
+            from = qMax(from + hlen, qsizetype(0));
+        if (from > hlen - nlen)
+            return -1;
+        if (!nlen)
+            return from;
+        if (nlen == 1)
+            return findChar(h, hlen, from, n[0], cs);
 
-        *dst++ = '"';
+        const ushort *s = h + from;
+        const qsizetype slen = hlen - from;
+        if (cs == Qt::CaseSensitive) {
+            const qsizetype i = ucstrstr(s, slen, n, nlen);
+            return i < 0 ? -1 : from + i;
+        }
+        const qsizetype starts = slen - nlen + 1;
+        if (n[0] < 0x80) {
+            for (qsizetype i = 0; i < starts; ++i) {
+                const qsizetype hit = qustrchr_foldCandidate(s + i, starts - i, n[0]);
+                if (hit < 0)
+                    return -1;
+                i += hit;
+                if (ucstrieq(s + i, n, nlen))
+                    return from + i;
+            }
+            return -1;
+        }
+        for (qsizetype i = 0; i < starts; ++i) {
+            if (ucstrieq(s + i, n, nlen))
+                return from + i;
+        }
+        return -1;
+    }
+
+    inline qsizetype findLastChar(const ushort *s, qsizetype len, qsizetype from, ushort c, Qt::CaseSensitivity cs) Q_DECL_NOTHROW
+    {
+        if (from < 0)
+            from += len;
+        if (from < 0 || from >= len)
+            return -1;
+        if (cs == Qt::CaseSensitive)
+            return qustrrchr(s, from + 1, c);
+        const uint folded = foldCase(c);
+        for (qsizetype i = from; i >= 0; --i) {
+            if (foldCase(s[i]) == folded)
+                return i;
+        }
+        return -1;
+    }
+
+    inline qsizetype findLastString(const ushort *h, qsizetype hlen, qsizetype from,
+                                    const ushort *n, qsizetype nlen, Qt::CaseSensitivity cs) Q_DECL_NOTHROW
+    {
+        if (nlen == 1)
+            return findLastChar(h, hlen, from, n[0], cs);
+        if (from < 0)
+            from += hlen;
+        if (from == hlen && nlen == 0)
+            return from;
+        const qsizetype delta = hlen - nlen;
+        if (from < 0 || from >= hlen || delta < 0)
+            return -1;
+        if (from > delta)
+            from = delta;
+        if (!nlen)
+            return from;
+        for (qsizetype i = from; i >= 0; --i) {
+            if (cs == Qt::CaseSensitive) {
+                if (h[i] == n[0] && h[i + nlen - 1] == n[nlen - 1]
+                        && ucstrmismatch(h + i + 1, n + 1, nlen - 2) == nlen - 2)
+                    return i;
+            } else if (ucstrieq(h + i, n, nlen)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    inline qsizetype countChar(const ushort *s, qsizetype len, ushort c, Qt::CaseSensitivity cs) Q_DECL_NOTHROW
+    {
+        if (cs == Qt::CaseSensitive)
+            return qustrcount(s, len, c);
+        const uint folded = foldCase(c);
+        qsizetype result = 0;
+        for (qsizetype i = 0; i < len; ++i)
+            result += foldCase(s[i]) == folded;
+        return result;
+    }
+
+    // overlapping occurrences, like QString::count()
+    inline qsizetype countString(const ushort *h, qsizetype hlen, const ushort *n, qsizetype nlen,
+                                 Qt::CaseSensitivity cs) Q_DECL_NOTHROW
+    {
+        if (nlen == 1)
+            return countChar(h, hlen, n[0], cs);
+        qsizetype result = 0;
+        for (qsizetype i = findString(h, hlen, 0, n, nlen, cs); i >= 0; i = findString(h, hlen, i + 1, n, nlen, cs))
+            ++result;
+        return result;
+    }
+
+    // Copies the leading ASCII characters of [src, src + len) to dst as bytes and
+    // returns how many there were. It may write further than that, up to len bytes,
+    // which is harmless for the encoders below since every code unit left over
+    // still encodes to at least one byte.
+#ifdef __SSE2__
+    inline qsizetype qustrtoascii_sse2(const ushort *src, qsizetype len, uchar *dst) Q_DECL_NOTHROW
+    {
+        const __m128i nonAscii = _mm_set1_epi16(short(0xff80));
+        const __m128i zeroes = _mm_setzero_si128();
+        qsizetype i = 0;
+        for ( ; i + 16 <= len; i += 16) {
+            const __m128i d0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            const __m128i d1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(d0, d1));
+            const quint32 ascii = _mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(d0, nonAscii), zeroes),
+                                                                    _mm_cmpeq_epi16(_mm_and_si128(d1, nonAscii), zeroes)));
+            if (ascii != 0xffff)
+                return i + qCountTrailingZeroBits(~ascii);
+        }
+        for ( ; i < len && src[i] < 0x80; ++i)
+            dst[i] = uchar(src[i]);
+        return i;
+    }
+#endif
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline qsizetype qustrtoascii_avx2(const ushort *src, qsizetype len, uchar *dst) Q_DECL_NOTHROW
+    {
+        const __m256i nonAscii = _mm256_set1_epi16(short(0xff80));
+        qsizetype i = 0;
+        for ( ; i + 32 <= len; i += 32) {
+            const __m256i d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+            const __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 16));
+            const __m256i any = _mm256_and_si256(_mm256_or_si256(d0, d1), nonAscii);
+            if (!_mm256_testz_si256(any, any))
+                break;
+            // packus works within 128-bit lanes; put the quadwords back in order
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(d0, d1), 0xd8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+        }
+        return i + qustrtoascii_sse2(src + i, len - i, dst + i);
+    }
+#endif
+
+    inline qsizetype qustrtoascii_generic(const ushort *src, qsizetype len, uchar *dst) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+        for ( ; i < len && src[i] < 0x80; ++i)
+            dst[i] = uchar(src[i]);
+        return i;
+    }
+
+    typedef qsizetype (*QustrtoasciiFunction)(const ushort *, qsizetype, uchar *);
+
+    inline QustrtoasciiFunction resolveQustrtoascii() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return qustrtoascii_avx2;
+#endif
+#ifdef __SSE2__
+        return qustrtoascii_sse2;
+#else
+        return qustrtoascii_generic;
+#endif
+    }
+
+    inline qsizetype qustrtoascii(const ushort *src, qsizetype len, uchar *dst) Q_DECL_NOTHROW
+    {
+        static const QustrtoasciiFunction impl = resolveQustrtoascii();
+        return impl(src, len, dst);
+    }
+
+    // UTF-8 needs at most 3 bytes per UTF-16 code unit (4 per surrogate pair)
+    Q_DECL_CONSTEXPR inline qsizetype maxUtf8Size(qsizetype len) Q_DECL_NOTHROW
+    {
+        return 3 * len;
+    }
+
+    // Encodes [src, src + len) as UTF-8 into dst, which must have room for
+    // maxUtf8Size(len) bytes, and returns the number of bytes written. Lone
+    // surrogates become '?', as in QString::toUtf8().
+    inline qsizetype utf16ToUtf8(const ushort *src, qsizetype len, uchar *dst) Q_DECL_NOTHROW
+    {
+        uchar *const start = dst;
+        qsizetype i = 0;
+        while (i < len) {
+            const qsizetype ascii = qustrtoascii(src + i, len - i, dst);
+            i += ascii;
+            dst += ascii;
+            for ( ; i < len && src[i] >= 0x80; ++i) {
+                uint u = src[i];
+                if (u < 0x800) {
+                    *dst++ = uchar(0xc0 | (u >> 6));
+                } else {
+                    if (QChar::isSurrogate(u)) {
+                        if (!QChar::isHighSurrogate(u) || i + 1 == len || !QChar::isLowSurrogate(src[i + 1])) {
+                            *dst++ = '?';
+                            continue;
+                        }
+                        u = QChar::surrogateToUcs4(ushort(u), src[++i]);
+                        *dst++ = uchar(0xf0 | (u >> 18));
+                        *dst++ = uchar(0x80 | ((u >> 12) & 0x3f));
+                    } else {
+                        *dst++ = uchar(0xe0 | (u >> 12));
+                    }
+                    *dst++ = uchar(0x80 | ((u >> 6) & 0x3f));
+                }
+                *dst++ = uchar(0x80 | (u & 0x3f));
+            }
+        }
+        return dst - start;
+    }
+
+    // Latin-1, with '?' for everything above U+00FF like QString::toLatin1()
+    inline void utf16ToLatin1_generic(const ushort *src, qsizetype len, uchar *dst) Q_DECL_NOTHROW
+    {
+        for (qsizetype i = 0; i < len; ++i)
+            dst[i] = src[i] > 0xff ? uchar('?') : uchar(src[i]);
+    }
+
+#ifdef __SSE2__
+    inline void utf16ToLatin1_sse2(const ushort *src, qsizetype len, uchar *dst) Q_DECL_NOTHROW
+    {
+        const __m128i questionMark = _mm_set1_epi16('?');
+        const __m128i high = _mm_set1_epi16(short(0xff00));
+        const __m128i zeroes = _mm_setzero_si128();
+        qsizetype i = 0;
+        for ( ; i + 16 <= len; i += 16) {
+            __m128i d0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            __m128i d1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8));
+            // no blendv in SSE2: select with and/andnot
+            const __m128i ok0 = _mm_cmpeq_epi16(_mm_and_si128(d0, high), zeroes);
+            const __m128i ok1 = _mm_cmpeq_epi16(_mm_and_si128(d1, high), zeroes);
+            d0 = _mm_or_si128(_mm_and_si128(ok0, d0), _mm_andnot_si128(ok0, questionMark));
+            d1 = _mm_or_si128(_mm_and_si128(ok1, d1), _mm_andnot_si128(ok1, questionMark));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(d0, d1));
+        }
+        utf16ToLatin1_generic(src + i, len - i, dst + i);
+    }
+#endif
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline void utf16ToLatin1_avx2(const ushort *src, qsizetype len, uchar *dst) Q_DECL_NOTHROW
+    {
+        const __m256i questionMark = _mm256_set1_epi16('?');
+        const __m256i high = _mm256_set1_epi16(short(0xff00));
+        const __m256i zeroes = _mm256_setzero_si256();
+        qsizetype i = 0;
+        for ( ; i + 32 <= len; i += 32) {
+            __m256i d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+            __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 16));
+            d0 = _mm256_blendv_epi8(questionMark, d0, _mm256_cmpeq_epi16(_mm256_and_si256(d0, high), zeroes));
+            d1 = _mm256_blendv_epi8(questionMark, d1, _mm256_cmpeq_epi16(_mm256_and_si256(d1, high), zeroes));
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(d0, d1), 0xd8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+        }
+        utf16ToLatin1_sse2(src + i, len - i, dst + i);
+    }
+#endif
+
+    typedef void (*Utf16ToLatin1Function)(const ushort *, qsizetype, uchar *);
+
+    inline Utf16ToLatin1Function resolveUtf16ToLatin1() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return utf16ToLatin1_avx2;
+#endif
+#ifdef __SSE2__
+        return utf16ToLatin1_sse2;
+#else
+        return utf16ToLatin1_generic;
+#endif
+    }
+
+    inline void utf16ToLatin1(const ushort *src, qsizetype len, uchar *dst) Q_DECL_NOTHROW
+    {
+        static const Utf16ToLatin1Function impl = resolveUtf16ToLatin1();
+        impl(src, len, dst);
+    }
+
+    // Returns the index of the first code unit of [s, s + len) that has any of the
+    // bits in mask set, or len: with 0xff80 that is the first one that is not ASCII,
+    // with 0xff00 the first that is not Latin-1.
+#ifdef __SSE2__
+    inline qsizetype qustrfindbits_sse2(const ushort *s, qsizetype len, ushort mask) Q_DECL_NOTHROW
+    {
+        const __m128i bits = _mm_set1_epi16(short(mask));
+        const __m128i zeroes = _mm_setzero_si128();
+        qsizetype i = 0;
+        for ( ; i + 16 <= len; i += 16) {
+            const __m128i d0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const __m128i d1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i + 8));
+            const quint32 clear = _mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(d0, bits), zeroes),
+                                                                    _mm_cmpeq_epi16(_mm_and_si128(d1, bits), zeroes)));
+            if (clear != 0xffff)
+                return i + qCountTrailingZeroBits(~clear);
+        }
+        if (i + 8 <= len) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const quint32 clear = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(data, bits), zeroes));
+            if (clear != 0xffff)
+                return i + qCountTrailingZeroBits(~clear) / 2;
+            i += 8;
+        }
+        for ( ; i < len && !(s[i] & mask); ++i)
+            ;
+        return i;
+    }
+#endif
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline qsizetype qustrfindbits_avx2(const ushort *s, qsizetype len, ushort mask) Q_DECL_NOTHROW
+    {
+        const __m256i bits = _mm256_set1_epi16(short(mask));
+        qsizetype i = 0;
+        for ( ; i + 32 <= len; i += 32) {
+            const __m256i d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+            const __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i + 16));
+            const __m256i any = _mm256_and_si256(_mm256_or_si256(d0, d1), bits);
+            if (!_mm256_testz_si256(any, any))
+                break;
+        }
+        return i + qustrfindbits_sse2(s + i, len - i, mask);
+    }
+#endif
+
+    inline qsizetype qustrfindbits_generic(const ushort *s, qsizetype len, ushort mask) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+        for ( ; i < len && !(s[i] & mask); ++i)
+            ;
+        return i;
+    }
+
+    typedef qsizetype (*QustrfindbitsFunction)(const ushort *, qsizetype, ushort);
+
+    inline QustrfindbitsFunction resolveQustrfindbits() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return qustrfindbits_avx2;
+#endif
+#ifdef __SSE2__
+        return qustrfindbits_sse2;
+#else
+        return qustrfindbits_generic;
+#endif
+    }
+
+    inline qsizetype qustrfindbits(const ushort *s, qsizetype len, ushort mask) Q_DECL_NOTHROW
+    {
+        static const QustrfindbitsFunction impl = resolveQustrfindbits();
+        return impl(s, len, mask);
+    }
+
+    // Returns the index of the first surrogate of [s, s + len) that is not half of a
+    // pair, or len if there is none. The vector kernels take a bit mask of where the
+    // high surrogates are, shift it along by one code unit and compare it with the
+    // mask of the low surrogates: the two only differ where a low surrogate has no
+    // high one before it, or a high one no low one after it. A high surrogate at the
+    // end of a block carries over into the next; the kernel that takes over from a
+    // wider one starts again at that high surrogate.
+    inline qsizetype qustrlonesurrogate_generic(const ushort *s, qsizetype len) Q_DECL_NOTHROW
+    {
+        bool pendingHigh = false;
+        for (qsizetype i = 0; i < len; ++i) {
+            const bool low = QChar::isLowSurrogate(s[i]);
+            if (low != pendingHigh)
+                return low ? i : i - 1;
+            pendingHigh = QChar::isHighSurrogate(s[i]);
+        }
+        return pendingHigh ? len - 1 : len;
+    }
+
+#ifdef __SSE2__
+    inline qsizetype qustrlonesurrogate_sse2(const ushort *s, qsizetype len) Q_DECL_NOTHROW
+    {
+        const __m128i tagBits = _mm_set1_epi16(short(0xfc00));
+        const __m128i highTag = _mm_set1_epi16(short(0xd800));
+        const __m128i lowTag = _mm_set1_epi16(short(0xdc00));
+        quint32 carry = 0;     // 3 if the last block ended in a high surrogate
+        qsizetype i = 0;
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i tags = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)), tagBits);
+            // two bits per code unit
+            const quint32 high = _mm_movemask_epi8(_mm_cmpeq_epi16(tags, highTag));
+            const quint32 low = _mm_movemask_epi8(_mm_cmpeq_epi16(tags, lowTag));
+            const quint32 expected = ((high << 2) | carry) & 0xffff;
+            if (expected != low) {
+                const qsizetype at = qCountTrailingZeroBits(expected ^ low) / 2;
+                return (low >> (2 * at)) & 1 ? i + at : i + at - 1;
+            }
+            carry = high >> 14;
+        }
+        const qsizetype rest = carry ? i - 1 : i;
+        return rest + qustrlonesurrogate_generic(s + rest, len - rest);
+    }
+#endif
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline qsizetype qustrlonesurrogate_avx2(const ushort *s, qsizetype len) Q_DECL_NOTHROW
+    {
+        const __m256i tagBits = _mm256_set1_epi16(short(0xfc00));
+        const __m256i highTag = _mm256_set1_epi16(short(0xd800));
+        const __m256i lowTag = _mm256_set1_epi16(short(0xdc00));
+        quint32 carry = 0;
+        qsizetype i = 0;
+        for ( ; i + 16 <= len; i += 16) {
+            const __m256i tags = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i)), tagBits);
+            const quint32 high = _mm256_movemask_epi8(_mm256_cmpeq_epi16(tags, highTag));
+            const quint32 low = _mm256_movemask_epi8(_mm256_cmpeq_epi16(tags, lowTag));
+            const quint32 expected = (high << 2) | carry;
+            if (expected != low) {
+                const qsizetype at = qCountTrailingZeroBits(expected ^ low) / 2;
+                return (low >> (2 * at)) & 1 ? i + at : i + at - 1;
+            }
+            carry = high >> 30;
+        }
+        const qsizetype rest = carry ? i - 1 : i;
+        return rest + qustrlonesurrogate_sse2(s + rest, len - rest);
+    }
+#endif
+
+    typedef qsizetype (*QustrlonesurrogateFunction)(const ushort *, qsizetype);
+
+    inline QustrlonesurrogateFunction resolveQustrlonesurrogate() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return qustrlonesurrogate_avx2;
+#endif
+#ifdef __SSE2__
+        return qustrlonesurrogate_sse2;
+#else
+        return qustrlonesurrogate_generic;
+#endif
+    }
+
+    inline qsizetype qustrlonesurrogate(const ushort *s, qsizetype len) Q_DECL_NOTHROW
+    {
+        static const QustrlonesurrogateFunction impl = resolveQustrlonesurrogate();
+        return impl(s, len);
+    }
+
+    // Decoding is the mirror image of the above: widens the leading ASCII bytes of
+    // [src, src + len) to dst and returns how many there were. It too may write
+    // further than that, up to len code units; UTF-8 never decodes to more code
+    // units than it has bytes, so that stays within what the decoder needs anyway.
+#ifdef __SSE2__
+    inline qsizetype qasciitoutf16_sse2(const uchar *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        const __m128i zeroes = _mm_setzero_si128();
+        qsizetype i = 0;
+        for ( ; i + 16 <= len; i += 16) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi8(data, zeroes));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpackhi_epi8(data, zeroes));
+            // the sign bits are exactly the non-ASCII bytes
+            const uint nonAscii = _mm_movemask_epi8(data);
+            if (nonAscii)
+                return i + qCountTrailingZeroBits(nonAscii);
+        }
+        for ( ; i < len && src[i] < 0x80; ++i)
+            dst[i] = src[i];
+        return i;
+    }
+#endif
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline qsizetype qasciitoutf16_avx2(const uchar *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+        for ( ; i + 32 <= len; i += 32) {
+            const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+            if (_mm256_movemask_epi8(data))
+                break;
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                                _mm256_cvtepu8_epi16(_mm256_castsi256_si128(data)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 16),
+                                _mm256_cvtepu8_epi16(_mm256_extracti128_si256(data, 1)));
+        }
+        return i + qasciitoutf16_sse2(src + i, len - i, dst + i);
+    }
+#endif
+
+    inline qsizetype qasciitoutf16_generic(const uchar *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+        for ( ; i < len && src[i] < 0x80; ++i)
+            dst[i] = src[i];
+        return i;
+    }
+
+    typedef qsizetype (*QasciitoUtf16Function)(const uchar *, qsizetype, ushort *);
+
+    inline QasciitoUtf16Function resolveQasciitoutf16() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return qasciitoutf16_avx2;
+#endif
+#ifdef __SSE2__
+        return qasciitoutf16_sse2;
+#else
+        return qasciitoutf16_generic;
+#endif
+    }
+
+    inline qsizetype qasciitoutf16(const uchar *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        static const QasciitoUtf16Function impl = resolveQasciitoutf16();
+        return impl(src, len, dst);
+    }
+
+    // Decodes the UTF-8 in [src, src + len) into dst, which must have room for len
+    // code units, and returns the number of code units written. Like
+    // QString::fromUtf8() it skips a leading BOM and replaces each byte that does
+    // not start a valid sequence (overlong forms, surrogates, values above
+    // U+10FFFF, stray or missing continuation bytes) with U+FFFD. *valid, if
+    // given, is set to whether there were no such bytes.
+    inline qsizetype utf8ToUtf16(const uchar *src, qsizetype len, ushort *dst, bool *valid = nullptr) Q_DECL_NOTHROW
+    {
+        ushort *const start = dst;
+        bool ok = true;
+        qsizetype i = 0;
+        if (len >= 3 && src[0] == 0xef && src[1] == 0xbb && src[2] == 0xbf)
+            i = 3;
+        while (i < len) {
+            const qsizetype ascii = qasciitoutf16(src + i, len - i, dst);
+            i += ascii;
+            dst += ascii;
+            while (i < len && src[i] >= 0x80) {
+                const uint b = src[i];
+                int continuations;
+                uint uc = 0, minimum = 0;
+                if (b < 0xc2) {
+                    continuations = -1;     // continuation byte, or an overlong lead
+                } else if (b < 0xe0) {
+                    continuations = 1; uc = b & 0x1f; minimum = 0x80;
+                } else if (b < 0xf0) {
+                    continuations = 2; uc = b & 0x0f; minimum = 0x800;
+                } else if (b < 0xf5) {
+                    continuations = 3; uc = b & 0x07; minimum = 0x10000;
+                } else {
+                    continuations = -1;
+                }
+                int n = 0;
+                if (continuations > 0 && i + continuations < len) {
+                    for ( ; n < continuations && (src[i + 1 + n] & 0xc0) == 0x80; ++n)
+                        uc = (uc << 6) | (src[i + 1 + n] & 0x3f);
+                }
+                if (n != continuations || n <= 0 || uc < minimum || uc > 0x10ffff || QChar::isSurrogate(uc)) {
+                    *dst++ = QChar::ReplacementCharacter;
+                    ok = false;
+                    ++i;
+                    continue;
+                }
+                if (QChar::requiresSurrogates(uc)) {
+                    *dst++ = QChar::highSurrogate(uc);
+                    *dst++ = QChar::lowSurrogate(uc);
+                } else {
+                    *dst++ = ushort(uc);
+                }
+                i += 1 + continuations;
+            }
+        }
+        if (valid)
+            *valid = ok;
+        return dst - start;
+    }
+
+    // Latin-1 maps byte for byte onto the first 256 code points
+    inline void latin1ToUtf16_generic(const uchar *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        for (qsizetype i = 0; i < len; ++i)
+            dst[i] = src[i];
+    }
+
+#ifdef __SSE2__
+    inline void latin1ToUtf16_sse2(const uchar *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        const __m128i zeroes = _mm_setzero_si128();
+        qsizetype i = 0;
+        for ( ; i + 16 <= len; i += 16) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi8(data, zeroes));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpackhi_epi8(data, zeroes));
+        }
+        latin1ToUtf16_generic(src + i, len - i, dst + i);
+    }
+#endif
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline void latin1ToUtf16_avx2(const uchar *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+        for ( ; i + 16 <= len; i += 16) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_cvtepu8_epi16(data));
+        }
+        latin1ToUtf16_generic(src + i, len - i, dst + i);
+    }
+#endif
+
+    typedef void (*Latin1ToUtf16Function)(const uchar *, qsizetype, ushort *);
+
+    inline Latin1ToUtf16Function resolveLatin1ToUtf16() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return latin1ToUtf16_avx2;
+#endif
+#ifdef __SSE2__
+        return latin1ToUtf16_sse2;
+#else
+        return latin1ToUtf16_generic;
+#endif
+    }
+
+    inline void latin1ToUtf16(const uchar *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        static const Latin1ToUtf16Function impl = resolveLatin1ToUtf16();
+        impl(src, len, dst);
+    }
+
+#ifdef __SSE2__
+    // Narrows the leading run of [src, src + len) that toPrettyUnicode() leaves as it is
+    // (printable ASCII other than '"' and '\\') to dst, 8 code units at a time, and
+    // returns its length. Stores whole blocks only, so it may write past the run, but
+    // never past dst + len; it returns less than 8 when no whole block fits.
+    inline qsizetype copyPrintableAscii_sse2(const ushort *src, qsizetype len, char *dst) Q_DECL_NOTHROW
+    {
+        const __m128i space = _mm_set1_epi16(0x20 - 1);
+        const __m128i del = _mm_set1_epi16(0x7f);
+        const __m128i quote = _mm_set1_epi16('"');
+        const __m128i backslash = _mm_set1_epi16('\\');
+        qsizetype i = 0;
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            const __m128i special = _mm_or_si128(_mm_cmpeq_epi16(data, quote), _mm_cmpeq_epi16(data, backslash));
+            const __m128i printable = _mm_andnot_si128(special, _mm_and_si128(_mm_cmpgt_epi16(data, space),
+                                                                              _mm_cmplt_epi16(data, del)));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(data, data));
+            const uint mask = uint(_mm_movemask_epi8(printable));
+            if (mask != 0xffff)
+                return i + qCountTrailingZeroBits(~mask) / 2;
+        }
+        return i;
+    }
+#endif
+
+    // Upper- (or lower-) cases the leading ASCII run of [src, src + len) into dst and
+    // returns its length. Past that the mapping can depend on the context or change
+    // the length of the string, which is QString::toUpper()'s business.
+    inline qsizetype mapAsciiCase(const ushort *src, qsizetype len, ushort *dst, bool upper) Q_DECL_NOTHROW
+    {
+        const ushort first = upper ? 'a' : 'A';
+        qsizetype i = 0;
+#ifdef __SSE2__
+        const __m128i nonAscii = _mm_set1_epi16(short(0xff80));
+        const __m128i zeroes = _mm_setzero_si128();
+        const __m128i below = _mm_set1_epi16(short(first - 1));
+        const __m128i above = _mm_set1_epi16(short(first + 26));
+        const __m128i caseBit = _mm_set1_epi16(0x20);
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(data, nonAscii), zeroes)) != 0xffff)
+                break;
+            const __m128i letters = _mm_and_si128(_mm_cmpgt_epi16(data, below), _mm_cmpgt_epi16(above, data));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_xor_si128(data, _mm_and_si128(letters, caseBit)));
+        }
+#endif
+        for ( ; i < len; ++i) {
+            const ushort c = src[i];
+            if (c >= 0x80)
+                break;
+            dst[i] = uint(c - first) < 26u ? ushort(c ^ 0x20) : c;
+        }
+        return i;
+    }
+
+    // wchar_t is UTF-32 almost everywhere but on Windows. Widens the leading run of
+    // BMP characters of [src, src + len) to dst and returns how many there were;
+    // like the ASCII kernels it may write up to len code units.
+    inline qsizetype qucs4tobmp_generic(const uint *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+        for ( ; i < len && src[i] < 0x10000; ++i)
+            dst[i] = ushort(src[i]);
+        return i;
+    }
+
+#ifdef __SSE2__
+    inline qsizetype qucs4tobmp_sse2(const uint *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        const __m128i zeroes = _mm_setzero_si128();
+        qsizetype i = 0;
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i d0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            const __m128i d1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 4));
+            const __m128i high = _mm_srli_epi32(_mm_or_si128(d0, d1), 16);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, zeroes)) != 0xffff)
+                break;
+            // no packus_epi32 before SSE4.1: sign-extend the low halves and use packs
+            const __m128i lo = _mm_srai_epi32(_mm_slli_epi32(d0, 16), 16);
+            const __m128i hi = _mm_srai_epi32(_mm_slli_epi32(d1, 16), 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(lo, hi));
+        }
+        return i + qucs4tobmp_generic(src + i, len - i, dst + i);
+    }
+#endif
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("avx2")
+    inline qsizetype qucs4tobmp_avx2(const uint *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+        for ( ; i + 16 <= len; i += 16) {
+            const __m256i d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+            const __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 8));
+            const __m256i high = _mm256_srli_epi32(_mm256_or_si256(d0, d1), 16);
+            if (!_mm256_testz_si256(high, high))
+                break;
+            // everything fits in 16 bits, so unsigned saturation changes nothing
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(d0, d1), 0xd8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+        }
+        return i + qucs4tobmp_sse2(src + i, len - i, dst + i);
+    }
+#endif
+
+    typedef qsizetype (*Qucs4tobmpFunction)(const uint *, qsizetype, ushort *);
+
+    inline Qucs4tobmpFunction resolveQucs4tobmp() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasAvx2())
+            return qucs4tobmp_avx2;
+#endif
+#ifdef __SSE2__
+        return qucs4tobmp_sse2;
+#else
+        return qucs4tobmp_generic;
+#endif
+    }
+
+    inline qsizetype qucs4tobmp(const uint *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        static const Qucs4tobmpFunction impl = resolveQucs4tobmp();
+        return impl(src, len, dst);
+    }
+
+    // Converts UTF-32 to UTF-16 into dst, which must have room for 2 * len code
+    // units, and returns the number of code units written. Values above U+10FFFF
+    // become U+FFFD.
+    inline qsizetype ucs4ToUtf16(const uint *src, qsizetype len, ushort *dst) Q_DECL_NOTHROW
+    {
+        ushort *const start = dst;
+        qsizetype i = 0;
+        while (i < len) {
+            const qsizetype bmp = qucs4tobmp(src + i, len - i, dst);
+            i += bmp;
+            dst += bmp;
+            for ( ; i < len && src[i] >= 0x10000; ++i) {
+                if (src[i] > 0x10ffff) {
+                    *dst++ = QChar::ReplacementCharacter;
+                } else {
+                    *dst++ = QChar::highSurrogate(src[i]);
+                    *dst++ = QChar::lowSurrogate(src[i]);
+                }
+            }
+        }
+        return dst - start;
+    }
+
+    // what ucstrcmp() computes, as a plain loop for constant evaluation
+    template <typename Char>
+    Q_DECL_RELAXED_CONSTEXPR int constexprCompare(const Char *a, qsizetype alen, const Char *b, qsizetype blen) Q_DECL_NOTHROW
+    {
+        const qsizetype len = alen < blen ? alen : blen;
+        for (qsizetype i = 0; i < len; ++i) {
+            if (a[i] != b[i])
+                return int(a[i]) - int(b[i]);
+        }
+        return alen < blen ? -1 : alen > blen ? 1 : 0;
+    }
+
+    // Qt 5 hashes a QString as h = 31 * h + c, starting from the seed, except for
+    // non-zero seeds where it was built with CRC32 support and the CPU has it: those
+    // get the CRC32C of the string's bytes, again starting from the seed.
+    inline uint qustrhash_generic(const ushort *p, qsizetype len, uint h) Q_DECL_NOTHROW
+    {
+        for (qsizetype i = 0; i < len; ++i)
+            h = 31 * h + p[i];
+        return h;
+    }
+
+    Q_DECL_CONSTEXPR inline uint pow31(int n) Q_DECL_NOTHROW
+    {
+        return n ? 31 * pow31(n - 1) : 1;
+    }
+
+#ifdef __SSE2__
+    // Eight characters at a time: h * 31^8 + c0 * 31^7 + ... + c7 * 31^0, all modulo
+    // 2^32. SSE2 has no 32-bit multiplication, so each c * 31^k is put together from
+    // 16 x 16 bit products of c with the low and the high half of 31^k.
+    inline uint qustrhash_sse2(const ushort *p, qsizetype len, uint h) Q_DECL_NOTHROW
+    {
+#define QEMUSTRINGVIEW_POW31_HALVES(shift) \
+        short(pow31(7) >> shift), short(pow31(6) >> shift), short(pow31(5) >> shift), short(pow31(4) >> shift), \
+        short(pow31(3) >> shift), short(pow31(2) >> shift), short(pow31(1) >> shift), short(pow31(0) >> shift)
+        const __m128i powLow = _mm_setr_epi16(QEMUSTRINGVIEW_POW31_HALVES(0));
+        const __m128i powHigh = _mm_setr_epi16(QEMUSTRINGVIEW_POW31_HALVES(16));
+#undef QEMUSTRINGVIEW_POW31_HALVES
+        qsizetype i = 0;
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            const __m128i low = _mm_mullo_epi16(c, powLow);
+            const __m128i high = _mm_add_epi16(_mm_mulhi_epu16(c, powLow), _mm_mullo_epi16(c, powHigh));
+            __m128i sum = _mm_add_epi32(_mm_unpacklo_epi16(low, high), _mm_unpackhi_epi16(low, high));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+            h = h * pow31(8) + uint(_mm_cvtsi128_si32(sum));
+        }
+        return qustrhash_generic(p + i, len - i, h);
+    }
+#endif
+
+    inline uint qustrhash(const ushort *p, qsizetype len, uint h) Q_DECL_NOTHROW
+    {
+#ifdef __SSE2__
+        return qustrhash_sse2(p, len, h);
+#else
+        return qustrhash_generic(p, len, h);
+#endif
+    }
+
+    // CRC32C without the usual pre- and post-inversion, as the SSE 4.2 and ARMv8
+    // instructions compute it
+    inline uint crc32c_generic(const uchar *p, qsizetype len, uint h) Q_DECL_NOTHROW
+    {
+        struct Table {
+            quint32 entries[256];
+            Table()
+            {
+                for (uint i = 0; i < 256; ++i) {
+                    uint c = i;
+                    for (int k = 0; k < 8; ++k)
+                        c = (c & 1) ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+                    entries[i] = c;
+                }
+            }
+        };
+        static const Table table;
+        for (qsizetype i = 0; i < len; ++i)
+            h = table.entries[(h ^ p[i]) & 0xff] ^ (h >> 8);
+        return h;
+    }
+
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    QEMUSTRINGVIEW_FUNCTION_TARGET("sse4.2")
+    inline uint crc32c_sse42(const uchar *p, qsizetype len, uint h) Q_DECL_NOTHROW
+    {
+        const uchar *const e = p + len;
+#ifdef Q_PROCESSOR_X86_64
+        quint64 h64 = h;
+        for ( ; e - p >= 8; p += 8) {
+            quint64 v;
+            std::memcpy(&v, p, sizeof(v));
+            h64 = _mm_crc32_u64(h64, v);
+        }
+        h = uint(h64);
+#endif
+        for ( ; e - p >= 4; p += 4) {
+            quint32 v;
+            std::memcpy(&v, p, sizeof(v));
+            h = _mm_crc32_u32(h, v);
+        }
+        for ( ; p < e; ++p)
+            h = _mm_crc32_u8(h, *p);
+        return h;
+    }
+#elif defined(__ARM_FEATURE_CRC32)
+    inline uint crc32c_arm(const uchar *p, qsizetype len, uint h) Q_DECL_NOTHROW
+    {
+        const uchar *const e = p + len;
+        for ( ; e - p >= 8; p += 8) {
+            quint64 v;
+            std::memcpy(&v, p, sizeof(v));
+            h = __crc32cd(h, v);
+        }
+        for ( ; p < e; ++p)
+            h = __crc32cb(h, *p);
+        return h;
+    }
+#endif
+
+    typedef uint (*Crc32cFunction)(const uchar *, qsizetype, uint);
+
+    inline Crc32cFunction resolveCrc32c() Q_DECL_NOTHROW
+    {
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+        if (cpuHasSse42())
+            return crc32c_sse42;
+#elif defined(__ARM_FEATURE_CRC32)
+        return crc32c_arm;
+#endif
+        return crc32c_generic;
+    }
+
+    inline uint crc32c(const uchar *p, qsizetype len, uint h) Q_DECL_NOTHROW
+    {
+        static const Crc32cFunction impl = resolveCrc32c();
+        return impl(p, len, h);
+    }
+
+    // Which of the two the Qt library in use does depends on how it was built as
+    // much as on the CPU, so ask it once: 'a' hashes to 31 * 1 + 'a' with seed 1
+    // unless it uses CRC32.
+    inline bool qtHashesWithCrc32()
+    {
+        static const bool crc = qHash(QString(QChar(ushort('a'))), 1u) != 31u + 'a';
+        return crc;
+    }
+
+    inline uint hashString(const ushort *p, qsizetype len, uint seed)
+    {
+        if (seed && qtHashesWithCrc32())
+            return crc32c(reinterpret_cast<const uchar *>(p), len * qsizetype(sizeof(ushort)), seed);
+        return qustrhash(p, len, seed);
+    }
+
+    // Number parsing follows QString::toLongLong() and QString::toDouble(), which use
+    // the C locale: whitespace around the number is skipped, group separators are
+    // not accepted and anything else left over makes the conversion fail.
+    inline bool isNumberSpace(ushort c) Q_DECL_NOTHROW
+    { return c == ' ' || (c >= '\t' && c <= '\r') || (c >= 0x80 && QChar(c).isSpace()); }
+
+    inline void trimNumberSpaces(const ushort *&begin, const ushort *&end) Q_DECL_NOTHROW
+    {
+        while (begin < end && isNumberSpace(*begin))
+            ++begin;
+        while (end > begin && isNumberSpace(end[-1]))
+            --end;
+    }
+
+    // the number of ASCII decimal digits at the start of [s, s + len)
+    inline qsizetype qustrdigits(const ushort *s, qsizetype len) Q_DECL_NOTHROW
+    {
+        qsizetype i = 0;
+#ifdef __SSE2__
+        // a code unit is a digit when c - '0', as a signed 16-bit value, is in [0, 9]
+        const __m128i zero = _mm_set1_epi16('0');
+        const __m128i ten = _mm_set1_epi16(10);
+        const __m128i minusOne = _mm_set1_epi16(-1);
+        for ( ; i + 8 <= len; i += 8) {
+            const __m128i d = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)), zero);
+            const uint mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi16(d, minusOne), _mm_cmplt_epi16(d, ten)));
+            if (mask != 0xffff)
+                return i + qCountTrailingZeroBits(quint32(~mask)) / 2;
+        }
+#endif
+        while (i < len && ushort(s[i] - '0') < 10)
+            ++i;
+        return i;
+    }
+
+#ifdef __SSE2__
+    // the value of the 8 decimal digits at s: adjacent digits are combined into pairs,
+    // the pairs into fours and the fours into the result by multiply-adds
+    inline uint eightDigits_sse2(const ushort *s) Q_DECL_NOTHROW
+    {
+        const __m128i d = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s)), _mm_set1_epi16('0'));
+        const __m128i pairs = _mm_madd_epi16(d, _mm_set_epi16(1, 10, 1, 10, 1, 10, 1, 10));
+        const __m128i fours = _mm_madd_epi16(_mm_packs_epi32(pairs, pairs), _mm_set_epi16(1, 100, 1, 100, 1, 100, 1, 100));
+        return uint(_mm_cvtsi128_si32(fours)) * 10000 + uint(_mm_cvtsi128_si32(_mm_srli_si128(fours, 4)));
+    }
+#endif
+
+    // *value * 10^n plus the n decimal digits at s, or false if that overflows
+    inline bool accumulateDecimal(const ushort *s, qsizetype n, qulonglong *value) Q_DECL_NOTHROW
+    {
+        qulonglong v = *value;
+        qsizetype i = 0;
+#ifdef __SSE2__
+        // while v * 10^8 + 99999999 is bound to fit
+        for ( ; i + 8 <= n && v <= Q_UINT64_C(184467440736); i += 8)
+            v = v * 100000000 + eightDigits_sse2(s + i);
+#endif
+        for ( ; i < n; ++i) {
+            const uint d = s[i] - '0';
+            if (v > (std::numeric_limits<qulonglong>::max() - d) / 10)
+                return false;
+            v = v * 10 + d;
+        }
+        *value = v;
+        return true;
+    }
+
+    // Parses all of [s, s + len) as an integer in the given base (0 to tell from a 0x
+    // or 0 prefix, as in C), into a sign and a magnitude. False if it is not one or
+    // the magnitude does not fit in 64 bits.
+    inline bool parseInteger(const ushort *s, qsizetype len, int base, bool *negative, qulonglong *magnitude) Q_DECL_NOTHROW
+    {
+        const ushort *end = s + len;
+        trimNumberSpaces(s, end);
+        *negative = false;
+        if (s < end && (*s == '+' || *s == '-'))
+            *negative = *s++ == '-';
+        if (base == 0 || base == 16) {
+            if (end - s > 2 && s[0] == '0' && (s[1] | 0x20) == 'x') {
+                s += 2;
+                base = 16;
+            } else if (base == 0) {
+                base = s < end && *s == '0' ? 8 : 10;
+            }
+        }
+        if (base < 2 || base > 36 || s == end)
+            return false;
+
+        qulonglong v = 0;
+        if (base == 10) {
+            const qsizetype n = end - s;
+            if (qustrdigits(s, n) != n || !accumulateDecimal(s, n, &v))
+                return false;
+        } else {
+            for ( ; s < end; ++s) {
+                const uint c = *s;
+                const uint d = c - '0' < 10 ? c - '0'
+                             : (c | 0x20) - 'a' < 26 ? (c | 0x20) - 'a' + 10 : 36;
+                if (d >= uint(base) || v > (std::numeric_limits<qulonglong>::max() - d) / uint(base))
+                    return false;
+                v = v * uint(base) + d;
+            }
+        }
+        *magnitude = v;
+        return true;
+    }
+
+    // The digits and the decimal exponent of a number, as far as parseDouble() needs them
+    struct DecimalNumber
+    {
+        qulonglong mantissa;    // the first (up to) 19 significant digits
+        int mantissaDigits;
+        int exponent;           // of the last digit in mantissa, clamped to +-99999
+        bool truncated;         // non-zero digits did not fit in mantissa
+    };
+
+    // skips n decimal digits at s, noting whether any of them is not 0
+    inline void skipDigits(const ushort *s, qsizetype n, DecimalNumber &num) Q_DECL_NOTHROW
+    {
+        for (qsizetype i = 0; i < n && !num.truncated; ++i)
+            num.truncated = s[i] != '0';
+    }
+
+    // takes the n decimal digits at s into num, after the decimal point or not
+    inline void takeDigits(const ushort *s, qsizetype n, bool fraction, DecimalNumber &num) Q_DECL_NOTHROW
+    {
+        qsizetype zeros = 0;
+        if (!num.mantissaDigits) {
+            while (zeros < n && s[zeros] == '0')
+                ++zeros;
+            if (fraction)
+                num.exponent -= int(qMin(zeros, qsizetype(100000)));
+        }
+        const qsizetype taken = qMin(n - zeros, qsizetype(19 - num.mantissaDigits));
+        accumulateDecimal(s + zeros, taken, &num.mantissa);
+        num.mantissaDigits += int(taken);
+        const qsizetype skipped = n - zeros - taken;
+        skipDigits(s + zeros + taken, skipped, num);
+        if (fraction)
+            num.exponent -= int(qMin(taken, qsizetype(100000)));
+        else
+            num.exponent += int(qMin(skipped, qsizetype(100000)));
+    }
+
+    // Parses all of [s, s + len) as a floating-point number like QString::toDouble():
+    // decimal, with an optional exponent, or inf or nan. Returns false, with *result
+    // 0, if it is not one, and also if it is out of range, with *result the infinity
+    // or 0 it was rounded to.
+    //
+    // Where the first 19 significant digits are all there is and make up no more than
+    // 2^53, and the exponent is within [-22, 22], both the digits and the power of ten
+    // are exact doubles and a single multiplication or division rounds correctly
+    // (Clinger's fast path). Everything else is correctly rounded by std::from_chars()
+    // or, before C++17, QByteArray::toDouble().
+    inline bool parseDouble(const ushort *s, qsizetype len, double *result)
+    {
+        const ushort *end = s + len;
+        trimNumberSpaces(s, end);
+        *result = 0;
+        const ushort *const begin = s;
+        bool negative = false;
+        if (s < end && (*s == '+' || *s == '-'))
+            negative = *s++ == '-';
+
+        if (end - s == 3) {
+            const uint a = s[0] | 0x20, b = s[1] | 0x20, c = s[2] | 0x20;
+            if (a == 'i' && b == 'n' && c == 'f') {
+                *result = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+                return true;
+            }
+            if (a == 'n' && b == 'a' && c == 'n' && s == begin) {
+                *result = std::numeric_limits<double>::quiet_NaN();
+                return true;
+            }
+        }
+
+        DecimalNumber num = { 0, 0, 0, false };
+        qsizetype n = qustrdigits(s, end - s);
+        bool anyDigits = n > 0;
+        takeDigits(s, n, false, num);
+        s += n;
+        if (s < end && *s == '.') {
+            ++s;
+            n = qustrdigits(s, end - s);
+            anyDigits = anyDigits || n > 0;
+            takeDigits(s, n, true, num);
+            s += n;
+        }
+        if (!anyDigits)
+            return false;
+        if (s < end && (*s | 0x20) == 'e') {
+            ++s;
+            bool negativeExponent = false;
+            if (s < end && (*s == '+' || *s == '-'))
+                negativeExponent = *s++ == '-';
+            n = qustrdigits(s, end - s);
+            if (!n)
+                return false;
+            int e = 0;
+            for (qsizetype i = 0; i < n && e < 100000; ++i)
+                e = e * 10 + (s[i] - '0');
+            num.exponent += negativeExponent ? -e : e;
+            s += n;
+        }
+        if (s != end)
+            return false;
+
+        if (!num.mantissa && !num.truncated) {
+            *result = negative ? -0.0 : 0.0;
+            return true;
+        }
+        if (!num.truncated && num.mantissa <= (Q_UINT64_C(1) << 53) && num.exponent >= -22 && num.exponent <= 22) {
+            static const double powersOf10[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+            const double m = double(num.mantissa);
+            const double d = num.exponent < 0 ? m / powersOf10[-num.exponent] : m * powersOf10[num.exponent];
+            *result = negative ? -d : d;
+            return true;
+        }
+
+        // everything in [begin, end) is ASCII by now
+        QVarLengthArray<char, 64> ascii(int(end - begin));
+        for (qsizetype i = 0; i < end - begin; ++i)
+            ascii[int(i)] = char(begin[i]);
+#ifdef QEMUSTRINGVIEW_HAVE_FROM_CHARS
+        // from_chars() takes no '+'
+        const char *first = ascii.constData() + (*begin == '+');
+        double d = 0;
+        if (std::from_chars(first, ascii.constData() + ascii.size(), d).ec == std::errc()) {
+            *result = d;
+            return true;
+        }
+        // out of range: the number is about mantissa * 10^(exponent + digits - 1)
+        if (num.exponent + num.mantissaDigits > 0) {
+            *result = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+            return false;
+        }
+        // Underflow, or a subnormal: libstdc++ before its fast_float from_chars()
+        // reports those as out of range too, but QString::toDouble() accepts them.
+        d = QByteArray::fromRawData(ascii.constData(), ascii.size()).toDouble();
+        if (d != 0 && std::isfinite(d)) {
+            *result = d;
+            return true;
+        }
+        return false;
+#else
+        bool ok = false;
+        *result = QByteArray::fromRawData(ascii.constData(), ascii.size()).toDouble(&ok);
+        return ok;
+#endif
+    }
+
+    // the constructors and operations that QEMUSTRINGVIEW_INSTRUMENT counts separately
+    enum InstrumentationSite {
+        SiteDefault,
+        SiteNullptr,
+        SiteQString,
+        SiteQStringPointer,
+        SitePointerLength,
+        SiteRange,
+        SiteArray,
+        SitePointer,
+        SiteQStringLike,
+        SiteStdString,
+        SiteStdWString,
+        SiteWCharPointer,
+        SiteAssignQString,
+        SiteAssignQStringPointer,
+        SiteSubstring,
+        SiteDecode,
+        SiteCompare,
+        SiteToString,
+        SiteToPrettyUnicode,
+        SiteCount
+    };
+    template <InstrumentationSite> struct SiteTag {};
+
+} // namespace QEmuPrivate
+
+#ifdef QEMUSTRINGVIEW_INSTRUMENT
+/*
+  Opt-in bookkeeping of where QEmuStringView objects come from and what they cost:
+  per constructor overload and per operation, how many ran, how many of those had to
+  allocate, and how many bytes they copied. Copies of an existing QEmuStringView are
+  not counted.
+
+  Each thread counts into its own block, which only that thread ever writes to, so
+  recording is a couple of relaxed loads and stores. The blocks are chained into a
+  list that is only ever pushed to, which lets snapshot() and dump() walk it from any
+  thread without locking. Blocks outlive their thread so that nothing a finished
+  worker counted gets lost. Set QEMUSTRINGVIEW_DUMP_STATS in the environment, or call
+  dumpAtExit(), to get the table on stderr when the process exits.
+*/
+class QEmuStringViewStats
+{
+public:
+    struct Counters {
+        quint64 objects;
+        quint64 allocations;
+        quint64 bytesCopied;
+    };
+    struct Snapshot {
+        Counters site[QEmuPrivate::SiteCount];
+
+        Counters total() const Q_DECL_NOTHROW
+        {
+            Counters t = { 0, 0, 0 };
+            for (const Counters &c : site) {
+                t.objects += c.objects;
+                t.allocations += c.allocations;
+                t.bytesCopied += c.bytesCopied;
+            }
+            return t;
+        }
+    };
+
+    static void record(QEmuPrivate::InstrumentationSite site, bool allocated, qsizetype bytes) Q_DECL_NOTHROW
+    {
+        std::atomic<quint64> *c = threadBlock()->counters[site];
+        bump(c[0], 1);
+        if (allocated)
+            bump(c[1], 1);
+        if (bytes > 0)
+            bump(c[2], quint64(bytes));
+    }
+
+    // everything counted by all threads since the last reset()
+    static Snapshot snapshot() Q_DECL_NOTHROW
+    {
+        Snapshot s = totals();
+        const std::atomic<quint64> (&base)[QEmuPrivate::SiteCount][3] = baseline();
+        for (int i = 0; i < QEmuPrivate::SiteCount; ++i) {
+            s.site[i].objects -= base[i][0].load(std::memory_order_relaxed);
+            s.site[i].allocations -= base[i][1].load(std::memory_order_relaxed);
+            s.site[i].bytesCopied -= base[i][2].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    // Other threads own their counters, so a reset only moves the baseline that
+    // snapshot() subtracts instead of zeroing anything.
+    static void reset() Q_DECL_NOTHROW
+    {
+        const Snapshot s = totals();
+        std::atomic<quint64> (&base)[QEmuPrivate::SiteCount][3] = baseline();
+        for (int i = 0; i < QEmuPrivate::SiteCount; ++i) {
+            base[i][0].store(s.site[i].objects, std::memory_order_relaxed);
+            base[i][1].store(s.site[i].allocations, std::memory_order_relaxed);
+            base[i][2].store(s.site[i].bytesCopied, std::memory_order_relaxed);
+        }
+    }
+
+    static const char *siteName(QEmuPrivate::InstrumentationSite site) Q_DECL_NOTHROW
+    {
+        static const char *const names[QEmuPrivate::SiteCount] = {
+            "QEmuStringView()",
+            "QEmuStringView(nullptr)",
+            "QEmuStringView(const QString &)",
+            "QEmuStringView(const QString *)",
+            "QEmuStringView(const Char *, qsizetype)",
+            "QEmuStringView(const Char *, const Char *)",
+            "QEmuStringView(const Char (&)[N])",
+            "QEmuStringView(const Char *)",
+            "QEmuStringView(QString/QStringRef)",
+            "QEmuStringView(std::basic_string)",
+            "QEmuStringView(std::wstring)",
+            "QEmuStringView(const wchar_t *)",
+            "operator=(const QString &)",
+            "operator=(const QString *)",
+            "mid/left/right/chopped/trimmed()",
+            "QEmuUtf16Buffer::fromUtf8/fromLatin1()",
+            "comparison operators",
+            "toString()",
+            "toPrettyUnicode()"
+        };
+        return site >= 0 && site < QEmuPrivate::SiteCount ? names[site] : "?";
+    }
+
+    static void dump(FILE *out = stderr)
+    {
+        const Snapshot s = snapshot();
+        std::fprintf(out, "QEmuStringView instrumentation:\n%-44s %12s %12s %14s\n",
+                     "site", "objects", "allocations", "bytes copied");
+        for (int i = 0; i < QEmuPrivate::SiteCount; ++i) {
+            const Counters &c = s.site[i];
+            if (!c.objects)
+                continue;
+            std::fprintf(out, "%-44s %12llu %12llu %14llu\n",
+                         siteName(QEmuPrivate::InstrumentationSite(i)),
+                         (unsigned long long)c.objects, (unsigned long long)c.allocations,
+                         (unsigned long long)c.bytesCopied);
+        }
+        const Counters t = s.total();
+        std::fprintf(out, "%-44s %12llu %12llu %14llu\n", "total",
+                     (unsigned long long)t.objects, (unsigned long long)t.allocations,
+                     (unsigned long long)t.bytesCopied);
+        std::fflush(out);
+    }
+
+    static void dumpAtExit()
+    {
+        static const bool registered = std::atexit(dumpAtExitHandler) == 0;
+        Q_UNUSED(registered);
+    }
+
+private:
+    struct Block {
+        std::atomic<quint64> counters[QEmuPrivate::SiteCount][3];
+        Block *next;
+    };
+
+    static void bump(std::atomic<quint64> &c, quint64 n) Q_DECL_NOTHROW
+    {
+        // only the owning thread writes, so there is no need for a locked add
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static std::atomic<Block *> &head() Q_DECL_NOTHROW
+    {
+        static std::atomic<Block *> list(nullptr);
+        return list;
+    }
+
+    static std::atomic<quint64> (&baseline() Q_DECL_NOTHROW)[QEmuPrivate::SiteCount][3]
+    {
+        static std::atomic<quint64> base[QEmuPrivate::SiteCount][3] = {};
+        return base;
+    }
+
+    static Block *registerBlock()
+    {
+        static const bool dumpRequested = std::getenv("QEMUSTRINGVIEW_DUMP_STATS") != nullptr;
+        if (dumpRequested)
+            dumpAtExit();
+
+        Block *b = new Block;
+        for (auto &site : b->counters) {
+            for (auto &c : site)
+                c.store(0, std::memory_order_relaxed);
+        }
+        b->next = head().load(std::memory_order_relaxed);
+        while (!head().compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        return b;
+    }
+
+    static Block *threadBlock()
+    {
+        static thread_local Block *block = registerBlock();
+        return block;
+    }
+
+    static Snapshot totals() Q_DECL_NOTHROW
+    {
+        Snapshot s;
+        for (Counters &c : s.site)
+            c.objects = c.allocations = c.bytesCopied = 0;
+        for (const Block *b = head().load(std::memory_order_acquire); b; b = b->next) {
+            for (int i = 0; i < QEmuPrivate::SiteCount; ++i) {
+                s.site[i].objects += b->counters[i][0].load(std::memory_order_relaxed);
+                s.site[i].allocations += b->counters[i][1].load(std::memory_order_relaxed);
+                s.site[i].bytesCopied += b->counters[i][2].load(std::memory_order_relaxed);
+            }
+        }
+        return s;
+    }
+
+    static void dumpAtExitHandler()
+    {
+        dump(stderr);
+    }
+};
+
+#  define QEMUSTRINGVIEW_RECORD(site, allocated, bytes) QEmuStringViewStats::record(site, allocated, bytes)
+// recording is not a constant expression
+#  define QEMUSTRINGVIEW_CONSTEXPR
+#  define QEMUSTRINGVIEW_RELAXED_CONSTEXPR
+#else
+#  define QEMUSTRINGVIEW_RECORD(site, allocated, bytes)
+#  define QEMUSTRINGVIEW_CONSTEXPR Q_DECL_CONSTEXPR
+#  define QEMUSTRINGVIEW_RELAXED_CONSTEXPR Q_DECL_RELAXED_CONSTEXPR
+#endif // QEMUSTRINGVIEW_INSTRUMENT
+
+// the comparison operators can only be constexpr where the compiler tells us
+// whether it is evaluating a constant expression
+#if defined(QEMUSTRINGVIEW_IS_CONSTANT_EVALUATED) && !defined(QEMUSTRINGVIEW_INSTRUMENT)
+#  define QEMUSTRINGVIEW_CONSTEXPR_COMPARISONS
+#  define QEMUSTRINGVIEW_COMPARE_CONSTEXPR Q_DECL_RELAXED_CONSTEXPR
+#else
+#  undef QEMUSTRINGVIEW_IS_CONSTANT_EVALUATED
+#  define QEMUSTRINGVIEW_IS_CONSTANT_EVALUATED() false
+#  define QEMUSTRINGVIEW_COMPARE_CONSTEXPR
+#endif
+
+class QEmuStringView;
+class QEmuStringTokenizer;
+class QEmuStringCodePoints;
+
+// How views are passed around: by value where a view is a (pointer, length) pair,
+// which goes in two registers, and by reference where copying one would copy a
+// QString and touch its reference count.
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+typedef QEmuStringView QEmuStringViewArg;
+#else
+typedef const QEmuStringView &QEmuStringViewArg;
+#endif
+
+/*
+  By default QEmuStringView is a QString that remembers where its data came from,
+  which means that all constructors from pointers, arrays and ranges make a deep copy.
+  #define QEMUSTRINGVIEW_ZEROCOPY to get a true view instead, which stores only a pointer
+  and a length, like QStringView does. QEmuStringView then no longer inherits QString,
+  so code that relied on that must call toString() explicitly.
+
+  In the QString-based mode, #define QEMUSTRINGVIEW_SSO to keep strings of up to
+  SsoCapacity (15) code units in the view itself instead of on the heap. The QString
+  a view then is refers to that storage, like a QStringLiteral() refers to its
+  literal, so a plain QString copy of a short view must not outlive the view: take
+  copies with toString(), which always makes a deep one.
+*/
+class QEmuStringView
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    : public QString
+#endif
+{
+public:
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+    // like QStringView, so that views onto u"" literals are constant expressions
+#if defined(Q_OS_WIN) && !defined(Q_COMPILER_UNICODE_STRINGS)
+    typedef wchar_t storage_type;
+#else
+    typedef char16_t storage_type;
+#endif
+#else
+    typedef QChar storage_type;
+#endif
+    typedef const QChar value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef qsizetype size_type;
+    typedef value_type &reference;
+    typedef value_type &const_reference;
+    typedef value_type *pointer;
+    typedef value_type *const_pointer;
+
+    typedef pointer iterator;
+    typedef const_pointer const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    template <typename Char>
+    using if_compatible_char = typename std::enable_if<QEmuPrivate::IsCompatibleCharType<Char>::value, bool>::type;
+
+    template <typename Array>
+    using if_compatible_array = typename std::enable_if<QEmuPrivate::IsCompatibleArray<Array>::value, bool>::type;
+
+    template <typename Pointer>
+    using if_compatible_pointer = typename std::enable_if<QEmuPrivate::IsCompatiblePointer<Pointer>::value, bool>::type;
+
+    template <typename T>
+    using if_compatible_string = typename std::enable_if<QEmuPrivate::IsCompatibleStdBasicString<T>::value, bool>::type;
+
+    template <typename T>
+    using if_compatible_qstring_like = typename std::enable_if<std::is_same<T, QString>::value || std::is_same<T, QStringRef>::value, bool>::type;
+
+    template <typename WChar>
+    using if_ucs4_wchar = typename std::enable_if<std::is_same<WChar, wchar_t>::value && sizeof(wchar_t) == sizeof(uint), bool>::type;
+
+    template <typename T>
+    using if_compatible_qstringview_like = typename std::enable_if<std::is_same<T, QStringView>::value || std::is_same<T, QEmuStringView>::value, bool>::type;
+
+    template <typename Char, size_t N>
+    static Q_DECL_CONSTEXPR qsizetype lengthHelperArray(const Char (&)[N]) Q_DECL_NOTHROW
+    {
+        return qsizetype(N - 1);
+    }
+
+    template <typename Char>
+    static qsizetype lengthHelperPointer(const Char *str) Q_DECL_NOTHROW
+    {
+        if (!str) {
+            return 0;
+        }
+#if defined(Q_CC_GNU) && !defined(Q_CC_CLANG) && !defined(Q_CC_INTEL)
+        if (__builtin_constant_p(*str)) {
+            qsizetype result = 0;
+            while (*str++)
+                ++result;
+            return result;
+        }
+#endif
+        return QEmuPrivate::qustrlen(reinterpret_cast<const ushort *>(str));
+    }
+    static qsizetype lengthHelperPointer(const QChar *str) Q_DECL_NOTHROW
+    {
+        return str ? QEmuPrivate::qustrlen(reinterpret_cast<const ushort *>(str)) : 0;
+    }
+
+    template <typename Char>
+    static const storage_type *castHelper(const Char *str) Q_DECL_NOTHROW
+    { return reinterpret_cast<const storage_type*>(str); }
+    static Q_DECL_CONSTEXPR const storage_type *castHelper(const storage_type *str) Q_DECL_NOTHROW
+    { return str; }
+    template <typename Char>
+    static Q_DECL_CONSTEXPR const storage_type *castHelper(const std::basic_string<Char> str) Q_DECL_NOTHROW
+    { return reinterpret_cast<const storage_type*>(str.data()); }
+
+    // compare a view to a (pointer, length) pair without building another QEmuStringView
+    template <typename Char>
+    static int compareHelper(const QEmuStringView &lhs, const Char *rhs, qsizetype len) Q_DECL_NOTHROW
+    {
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteCompare, false, 0);
+        return QEmuPrivate::ucstrcmp(lhs.rawUtf16(), lhs.size(), reinterpret_cast<const ushort *>(rhs), len);
+    }
+    template <typename Char>
+    static bool equalHelper(const QEmuStringView &lhs, const Char *rhs, qsizetype len) Q_DECL_NOTHROW
+    {
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteCompare, false, 0);
+        return QEmuPrivate::ucstreq(lhs.rawUtf16(), lhs.size(), reinterpret_cast<const ushort *>(rhs), len);
+    }
+
+public:
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+    QEMUSTRINGVIEW_CONSTEXPR QEmuStringView() Q_DECL_NOTHROW
+        : m_size(0), m_data(nullptr)
+    { QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteDefault, false, 0); }
+    QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(std::nullptr_t) Q_DECL_NOTHROW
+        : m_size(0), m_data(nullptr)
+    { QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteNullptr, false, 0); }
+    inline QEmuStringView(const QString *that) Q_DECL_NOTHROW
+        : QEmuStringView(that && !that->isNull() ? that->data() : nullptr, that ? qsizetype(that->size()) : 0,
+                         QEmuPrivate::SiteTag<QEmuPrivate::SiteQStringPointer>()) {}
+
+template <typename Char, if_compatible_char<Char> = true>
+    QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Char *str, qsizetype len)
+        : QEmuStringView(str, len, QEmuPrivate::SiteTag<QEmuPrivate::SitePointerLength>()) {}
+template <typename Char, if_compatible_char<Char> = true>
+    QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Char *f, const Char *l)
+        : QEmuStringView(f, l - f, QEmuPrivate::SiteTag<QEmuPrivate::SiteRange>()) {}
+template <typename Array, if_compatible_array<Array> = true>
+    QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Array &str) Q_DECL_NOTHROW
+        : QEmuStringView(str, lengthHelperArray(str), QEmuPrivate::SiteTag<QEmuPrivate::SiteArray>()) {}
+
+template <typename Pointer, if_compatible_pointer<Pointer> = true>
+    QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Pointer &str) Q_DECL_NOTHROW
+        : QEmuStringView(str, str ? lengthHelperPointer(str) : 0, QEmuPrivate::SiteTag<QEmuPrivate::SitePointer>()) {}
+
+template <typename String, if_compatible_qstring_like<String> = true>
+    QEmuStringView(const String &str) Q_DECL_NOTHROW
+        : QEmuStringView(str.isNull() ? nullptr : str.data(), qsizetype(str.size()),
+                         QEmuPrivate::SiteTag<QEmuPrivate::SiteQStringLike>()) {}
+template <typename StdBasicString, if_compatible_string<StdBasicString> = true>
+    QEmuStringView(const StdBasicString &str) Q_DECL_NOTHROW
+        : QEmuStringView(str.data(), qsizetype(str.size()), QEmuPrivate::SiteTag<QEmuPrivate::SiteStdString>()) {}
+
+    // wchar_t strings are only accepted where wchar_t is UTF-16 (IsCompatibleCharType);
+    // elsewhere QEmuUtf16Buffer::fromWCharArray() converts them
+
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR qsizetype size() const Q_DECL_NOTHROW { return m_size; }
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR int length() const Q_DECL_NOTHROW { return int(m_size); }
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR bool isNull() const Q_DECL_NOTHROW { return !m_data; }
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR bool isEmpty() const Q_DECL_NOTHROW { return !m_size; }
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR bool empty() const Q_DECL_NOTHROW { return !m_size; }
+
+    Q_REQUIRED_RESULT const_pointer data() const Q_DECL_NOTHROW { return reinterpret_cast<const_pointer>(m_data); }
+    Q_REQUIRED_RESULT const_pointer constData() const Q_DECL_NOTHROW { return data(); }
+    Q_REQUIRED_RESULT const_pointer unicode() const Q_DECL_NOTHROW { return data(); }
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR const storage_type *utf16() const Q_DECL_NOTHROW { return m_data; }
+
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR QChar operator[](qsizetype n) const
+    { return Q_ASSERT10(n >= 0), Q_ASSERT10(n < size()), QChar(ushort(m_data[n])); }
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR QChar at(qsizetype n) const { return (*this)[n]; }
+
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR QChar first() const { return at(0); }
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR QChar front() const { return at(0); }
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR QChar last()  const { return at(size() - 1); }
+    Q_REQUIRED_RESULT Q_DECL_CONSTEXPR QChar back()  const { return at(size() - 1); }
+
+    Q_REQUIRED_RESULT const_iterator begin()   const Q_DECL_NOTHROW { return data(); }
+    Q_REQUIRED_RESULT const_iterator end()     const Q_DECL_NOTHROW { return data() + size(); }
+    Q_REQUIRED_RESULT const_iterator cbegin()  const Q_DECL_NOTHROW { return begin(); }
+    Q_REQUIRED_RESULT const_iterator cend()    const Q_DECL_NOTHROW { return end(); }
+    Q_REQUIRED_RESULT const_reverse_iterator rbegin()  const Q_DECL_NOTHROW { return const_reverse_iterator(end()); }
+    Q_REQUIRED_RESULT const_reverse_iterator rend()    const Q_DECL_NOTHROW { return const_reverse_iterator(begin()); }
+    Q_REQUIRED_RESULT const_reverse_iterator crbegin() const Q_DECL_NOTHROW { return rbegin(); }
+    Q_REQUIRED_RESULT const_reverse_iterator crend()   const Q_DECL_NOTHROW { return rend(); }
+
+    Q_REQUIRED_RESULT inline QString toString() const
+    {
+        // the one place where a view allocates
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteToString, size() > 0, size() * qsizetype(sizeof(QChar)));
+        return QString(data(), int(size()));
+    }
+#else
+    inline QEmuStringView()
+        : QString()
+    { QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteDefault, false, 0); }
+    QEmuStringView(std::nullptr_t) Q_DECL_NOTHROW
+        : QString(), m_data(nullData())
+    { QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteNullptr, false, 0); }
+#ifdef QEMUSTRINGVIEW_SSO
+    // strings of up to SsoCapacity code units are stored in the view itself
+    enum { SsoCapacity = 15 };
+
+    QEmuStringView(const QEmuStringView &other) Q_DECL_NOTHROW
+        : QString()
+    { copyFrom(other); }
+    QEmuStringView &operator=(const QEmuStringView &other) Q_DECL_NOTHROW
+    {
+        if (this != &other)
+            copyFrom(other);
+        return *this;
+    }
+#endif
+    inline QEmuStringView(const QString &that)
+        : QString(that)
+    {
+        // QString only deep-copies data it cannot share
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteQString, QString::constData() != that.constData(),
+                              QString::constData() != that.constData() ? size() * qsizetype(sizeof(QChar)) : 0);
+    }
+    inline QEmuStringView(const QString *that)
+    {
+        if (that) {
+            QString::operator=(*that);
+        } else {
+            clear();
+            m_data = nullData();
+        }
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteQStringPointer, that && QString::constData() != that->constData(),
+                              that && QString::constData() != that->constData() ? size() * qsizetype(sizeof(QChar)) : 0);
+    }
+
+//     inline QEmuStringView(const QChar *str, qsizetype len=-1)
+//         : QString(str,len) {}
+template <typename Char, if_compatible_char<Char> = true>
+    inline QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Char *str, qsizetype len)
+        : QEmuStringView(str, len, QEmuPrivate::SiteTag<QEmuPrivate::SitePointerLength>()) {}
+template <typename Char, if_compatible_char<Char> = true>
+    inline QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Char *f, const Char *l)
+        : QEmuStringView(f, l - f, QEmuPrivate::SiteTag<QEmuPrivate::SiteRange>()) {}
+template <typename Array, if_compatible_array<Array> = true>
+    QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Array &str) Q_DECL_NOTHROW
+        : QEmuStringView(str, lengthHelperArray(str), QEmuPrivate::SiteTag<QEmuPrivate::SiteArray>()) {}
+
+template <typename Pointer, if_compatible_pointer<Pointer> = true>
+    QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Pointer &str) Q_DECL_NOTHROW
+        : QEmuStringView(str, str ? lengthHelperPointer(str) : 0, QEmuPrivate::SiteTag<QEmuPrivate::SitePointer>()) {}
+
+template <typename String, if_compatible_qstring_like<String> = true>
+    inline QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const String &str) Q_DECL_NOTHROW
+        : QEmuStringView(str.isNull() ? nullptr : str.data(), qsizetype(str.size()),
+                         QEmuPrivate::SiteTag<QEmuPrivate::SiteQStringLike>()) {}
+template <typename StdBasicString, if_compatible_string<StdBasicString> = true>
+    QEmuStringView(const StdBasicString &str) Q_DECL_NOTHROW
+        : QEmuStringView(str.data(), qsizetype(str.size()), QEmuPrivate::SiteTag<QEmuPrivate::SiteStdString>()) {}
+
+    // Where wchar_t is UTF-16 the constructors above take wchar_t strings like any
+    // other. Where it is UTF-32 these transcode straight into the QString, without
+    // the temporary std::wstring and QString that fromStdWString() would build.
+template <typename WChar, if_ucs4_wchar<WChar> = true>
+    inline QEmuStringView(const std::basic_string<WChar> &str)
+        : QString(fromUcs4Helper(str.data(), qsizetype(str.size())))
+    { QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteStdWString, !QString::isEmpty(), QString::size() * qsizetype(sizeof(QChar))); }
+template <typename WChar, if_ucs4_wchar<WChar> = true>
+    inline QEmuStringView(const WChar *str)
+        : QString(str ? fromUcs4Helper(str, qsizetype(wcslen(str))) : QString())
+        , m_data(str ? nullptr : nullData())
+    { QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteWCharPointer, !QString::isEmpty(), QString::size() * qsizetype(sizeof(QChar))); }
+
+
+    inline bool empty() {return QString::size() == 0 ; }
+
+    inline QString toString() const
+    {
+        // detour via QStringRef::toString() which makes the required deep copy
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteToString, size() > 0, size() * qsizetype(sizeof(QChar)));
+#ifdef QEMUSTRINGVIEW_SSO
+        // ... except that it would share the QString, and with it m_sso
+        if (isShort())
+            return QString(QString::constData(), QString::size());
+#endif
+        return QStringRef(this).toString();
+    }
+
+    inline QEmuStringView &operator=(const QString &other) Q_DECL_NOTHROW
+    {
+        *(static_cast<QString*>(this)) = other;
+        m_data = nullptr;
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteAssignQString, false, 0);
+        return *this;
+    }
+    inline QEmuStringView &operator=(const QString *other) Q_DECL_NOTHROW
+    {
+        if (other) {
+            *(static_cast<QString*>(this)) = *other;
+            m_data = nullptr;
+        } else {
+            QString::clear();
+            m_data = nullData();
+        }
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteAssignQStringPointer, false, 0);
+        return *this;
+    }
+    Q_REQUIRED_RESULT const QChar operator[](qsizetype n) const
+    { return Q_ASSERT10(n >= 0), Q_ASSERT10(n < size()), at(n); }
+
+    inline const QChar *unicode() const
+    {
+        return isNullView() ? nullptr : QString::unicode();
+    }
+    inline const_pointer data() const
+    {
+        return isNullView() ? nullptr :
+            hasData() ? static_cast<const_pointer>(m_data) : QString::data();
+    }
+    inline QChar *data()
+    {
+        // another nice hack to return a non-const version of m_data...
+        void** pp = const_cast<void**>(&m_data);
+        return isNullView() ? nullptr :
+            hasData() ? static_cast<QChar*>(*pp) : QString::data();
+    }
+    inline const QChar *constData() const
+    {
+        return isNullView() ? nullptr :
+            hasData() ? static_cast<const QChar*>(m_data) :QString::constData();
+    }
+
+    const ushort *utf16() const
+    {
+        return (isNullView() || isNull()) ? nullptr : QString::utf16();
+    }
+
+    Q_REQUIRED_RESULT inline QChar first() const { return at(0); }
+    Q_REQUIRED_RESULT inline QChar front() const { return at(0); }
+    Q_REQUIRED_RESULT inline QChar last()  const { return at(size() - 1); }
+    Q_REQUIRED_RESULT inline QChar back()  const { return at(size() - 1); }
+#endif // QEMUSTRINGVIEW_ZEROCOPY
+
+    // None of these copy characters: the result refers to the same data as this view,
+    // so it is valid only for as long as that data is (in the QString-based mode it is
+    // a QString::fromRawData()). mid(), left(), right(), chop() and truncate() clamp
+    // their arguments like QString's do, chopped() asserts like QStringView's.
+    Q_REQUIRED_RESULT QEmuStringView mid(qsizetype pos, qsizetype n = -1) const
+    {
+        const qsizetype len = size();
+        if (pos > len)
+            return slice(nullptr, 0);
+        if (pos < 0) {
+            if (n < 0 || n + pos >= len)
+                return *this;
+            if (n + pos <= 0)
+                return slice(nullptr, 0);
+            n += pos;
+            pos = 0;
+        } else if (size_t(n) > size_t(len - pos)) {
+            n = len - pos;
+        }
+        if (pos == 0 && n == len)
+            return *this;
+        return slice(constData() + pos, n);
+    }
+    Q_REQUIRED_RESULT QEmuStringView left(qsizetype n) const
+    { return size_t(n) >= size_t(size()) ? *this : slice(constData(), n); }
+    Q_REQUIRED_RESULT QEmuStringView right(qsizetype n) const
+    { return size_t(n) >= size_t(size()) ? *this : slice(constData() + size() - n, n); }
+    Q_REQUIRED_RESULT QEmuStringView chopped(qsizetype n) const
+    { return Q_ASSERT10(n >= 0), Q_ASSERT10(n <= size()), slice(constData(), size() - n); }
+
+    void truncate(qsizetype n)
+    {
+        if (n < size())
+            *this = slice(constData(), qMax(n, qsizetype(0)));
+    }
+    void chop(qsizetype n)
+    {
+        if (n > 0)
+            truncate(size() - n);
+    }
+
+    Q_REQUIRED_RESULT QEmuStringView trimmed() const
+    {
+        const QChar *begin = constData();
+        const QChar *end = begin + size();
+        const QChar *first = begin;
+        while (first < end && first->isSpace())
+            ++first;
+        const QChar *last = end;
+        while (last > first && last[-1].isSpace())
+            --last;
+        if (first == begin && last == end)
+            return *this;
+        return slice(first, last - first);
+    }
+
+    // Searching runs on the view's own data, with the SIMD kernels from QEmuPrivate
+    // for the case-sensitive searches and an ASCII prefilter for the others.
+    Q_REQUIRED_RESULT qsizetype indexOf(QChar c, qsizetype from = 0, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return QEmuPrivate::findChar(rawUtf16(), size(), from, c.unicode(), cs); }
+    Q_REQUIRED_RESULT qsizetype indexOf(QEmuStringViewArg s, qsizetype from = 0, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return QEmuPrivate::findString(rawUtf16(), size(), from, s.rawUtf16(), s.size(), cs); }
+    Q_REQUIRED_RESULT qsizetype lastIndexOf(QChar c, qsizetype from = -1, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return QEmuPrivate::findLastChar(rawUtf16(), size(), from, c.unicode(), cs); }
+    Q_REQUIRED_RESULT qsizetype lastIndexOf(QEmuStringViewArg s, qsizetype from = -1, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return QEmuPrivate::findLastString(rawUtf16(), size(), from, s.rawUtf16(), s.size(), cs); }
+
+    Q_REQUIRED_RESULT bool contains(QChar c, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return indexOf(c, 0, cs) != -1; }
+    Q_REQUIRED_RESULT bool contains(QEmuStringViewArg s, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return indexOf(s, 0, cs) != -1; }
+
+    Q_REQUIRED_RESULT qsizetype count(QChar c, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return QEmuPrivate::countChar(rawUtf16(), size(), c.unicode(), cs); }
+    Q_REQUIRED_RESULT qsizetype count(QEmuStringViewArg s, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return QEmuPrivate::countString(rawUtf16(), size(), s.rawUtf16(), s.size(), cs); }
+
+    // a null view only starts or ends with another null view, like in QString
+    Q_REQUIRED_RESULT bool startsWith(QEmuStringViewArg s, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return isNull() ? s.isNull() : s.size() <= size() && matchesAt(0, s, cs); }
+    Q_REQUIRED_RESULT bool startsWith(QChar c) const Q_DECL_NOTHROW
+    { return !isEmpty() && front() == c; }
+    Q_REQUIRED_RESULT bool startsWith(QChar c, Qt::CaseSensitivity cs) const Q_DECL_NOTHROW
+    { return !isEmpty() && (cs == Qt::CaseSensitive ? front() == c : QEmuPrivate::foldCase(front().unicode()) == QEmuPrivate::foldCase(c.unicode())); }
+    Q_REQUIRED_RESULT bool endsWith(QEmuStringViewArg s, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    { return isNull() ? s.isNull() : s.size() <= size() && matchesAt(size() - s.size(), s, cs); }
+    Q_REQUIRED_RESULT bool endsWith(QChar c) const Q_DECL_NOTHROW
+    { return !isEmpty() && back() == c; }
+    Q_REQUIRED_RESULT bool endsWith(QChar c, Qt::CaseSensitivity cs) const Q_DECL_NOTHROW
+    { return !isEmpty() && (cs == Qt::CaseSensitive ? back() == c : QEmuPrivate::foldCase(back().unicode()) == QEmuPrivate::foldCase(c.unicode())); }
+
+    // Lazy counterparts of QString::split(): the result is a forward range that finds
+    // one separator per step and yields views onto this view's data, so it must not
+    // outlive that data. Splitting never allocates in the zero-copy mode. tokenize()
+    // is the Qt 6 name for the same thing.
+    Q_REQUIRED_RESULT inline QEmuStringTokenizer split(QEmuStringViewArg sep, QString::SplitBehavior behavior = QString::KeepEmptyParts,
+                                                       Qt::CaseSensitivity cs = Qt::CaseSensitive) const;
+    Q_REQUIRED_RESULT inline QEmuStringTokenizer split(QChar sep, QString::SplitBehavior behavior = QString::KeepEmptyParts,
+                                                       Qt::CaseSensitivity cs = Qt::CaseSensitive) const;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    Q_REQUIRED_RESULT inline QEmuStringTokenizer split(QEmuStringViewArg sep, Qt::SplitBehavior behavior,
+                                                       Qt::CaseSensitivity cs = Qt::CaseSensitive) const;
+    Q_REQUIRED_RESULT inline QEmuStringTokenizer split(QChar sep, Qt::SplitBehavior behavior,
+                                                       Qt::CaseSensitivity cs = Qt::CaseSensitive) const;
+#endif
+    template <typename Sep, typename... Args>
+    Q_REQUIRED_RESULT auto tokenize(const Sep &sep, Args &&...args) const -> decltype(this->split(sep, std::forward<Args>(args)...))
+    { return split(sep, std::forward<Args>(args)...); }
+
+    // Without allocating or building a QString, unlike QString::compare(). Case-insensitive
+    // comparisons fold ASCII 8 characters at a time.
+    Q_REQUIRED_RESULT int compare(QEmuStringViewArg other, Qt::CaseSensitivity cs = Qt::CaseSensitive) const Q_DECL_NOTHROW
+    {
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteCompare, false, 0);
+        if (cs == Qt::CaseSensitive)
+            return QEmuPrivate::ucstrcmp(rawUtf16(), size(), other.rawUtf16(), other.size());
+        return QEmuPrivate::ucstricmp(rawUtf16(), size(), other.rawUtf16(), other.size());
+    }
+    Q_REQUIRED_RESULT bool equalsIgnoreCase(QEmuStringViewArg other) const Q_DECL_NOTHROW
+    {
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteCompare, false, 0);
+        return size() == other.size() && QEmuPrivate::ucstrieq(rawUtf16(), other.rawUtf16(), size());
+    }
+
+    // Encoding reads data() directly instead of going through toString(). The
+    // overloads that take a buffer write at most maxUtf8Size() or size() bytes and
+    // return how many they wrote; the ones that take a QByteArray reuse its
+    // capacity, so neither allocates once the capacity has been reserve()d.
+    Q_REQUIRED_RESULT QByteArray toUtf8() const
+    {
+        if (isNull())
+            return QByteArray();
+        // optimistically sized for ASCII, grown on the first character that is not
+        QByteArray result(int(size()), Qt::Uninitialized);
+        uchar *dst = reinterpret_cast<uchar *>(result.data());
+        const qsizetype ascii = QEmuPrivate::qustrtoascii(rawUtf16(), size(), dst);
+        if (ascii < size()) {
+            result.resize(int(ascii + QEmuPrivate::maxUtf8Size(size() - ascii)));
+            dst = reinterpret_cast<uchar *>(result.data());
+            result.resize(int(ascii + QEmuPrivate::utf16ToUtf8(rawUtf16() + ascii, size() - ascii, dst + ascii)));
+        }
+        return result;
+    }
+    Q_REQUIRED_RESULT QByteArray toLatin1() const
+    {
+        if (isNull())
+            return QByteArray();
+        QByteArray result(int(size()), Qt::Uninitialized);
+        QEmuPrivate::utf16ToLatin1(rawUtf16(), size(), reinterpret_cast<uchar *>(result.data()));
+        return result;
+    }
+    Q_REQUIRED_RESULT QByteArray toLocal8Bit() const
+    {
+#ifndef QT_NO_TEXTCODEC
+        if (QTextCodec *codec = QTextCodec::codecForLocale()) {
+            // the common locale encodings don't need the codec
+            switch (codec->mibEnum()) {
+            case 106:
+                return toUtf8();
+            case 4:
+                return toLatin1();
+            default:
+                return isNull() ? QByteArray() : codec->fromUnicode(constData(), int(size()));
+            }
+        }
+#endif
+        return toLatin1();
+    }
+
+    Q_REQUIRED_RESULT qsizetype maxUtf8Size() const Q_DECL_NOTHROW { return QEmuPrivate::maxUtf8Size(size()); }
+    qsizetype toUtf8(char *buffer) const Q_DECL_NOTHROW
+    { return QEmuPrivate::utf16ToUtf8(rawUtf16(), size(), reinterpret_cast<uchar *>(buffer)); }
+    qsizetype toLatin1(char *buffer) const Q_DECL_NOTHROW
+    {
+        QEmuPrivate::utf16ToLatin1(rawUtf16(), size(), reinterpret_cast<uchar *>(buffer));
+        return size();
+    }
+    void toUtf8(QByteArray &out) const
+    {
+        out.resize(int(maxUtf8Size()));
+        out.resize(int(toUtf8(out.data())));
+    }
+    void toLatin1(QByteArray &out) const
+    {
+        out.resize(int(size()));
+        toLatin1(out.data());
+    }
+
+    // Classify the whole view with the SIMD kernels, 16 or 32 code units at a time
+    // for isAscii() and isLatin1() and 8 or 16 at a time for isValidUtf16(), which
+    // checks that every surrogate is half of a high-low pair. A view that passes
+    // isAscii() or isLatin1() encodes to toLatin1() without any '?'.
+    Q_REQUIRED_RESULT bool isAscii() const Q_DECL_NOTHROW
+    { return QEmuPrivate::qustrfindbits(rawUtf16(), size(), 0xff80) == size(); }
+    Q_REQUIRED_RESULT bool isLatin1() const Q_DECL_NOTHROW
+    { return QEmuPrivate::qustrfindbits(rawUtf16(), size(), 0xff00) == size(); }
+    Q_REQUIRED_RESULT bool isValidUtf16() const Q_DECL_NOTHROW
+    { return QEmuPrivate::qustrlonesurrogate(rawUtf16(), size()) == size(); }
+
+    // The code points of the view as char32_t, a surrogate pair at a time where there
+    // is one, and U+FFFD for a lone surrogate. Like split(), the range refers to this
+    // view's data.
+    Q_REQUIRED_RESULT inline QEmuStringCodePoints codePoints() const;
+
+    // Like QString::toInt() and friends, in the C locale, but on the view's own data:
+    // decimal digits are checked and converted 8 at a time, and toDouble() computes
+    // its correctly rounded result without a detour through 8-bit text wherever it
+    // can do that exactly.
+    Q_REQUIRED_RESULT short toShort(bool *ok = nullptr, int base = 10) const { return toIntegral<short>(ok, base); }
+    Q_REQUIRED_RESULT ushort toUShort(bool *ok = nullptr, int base = 10) const { return toIntegral<ushort>(ok, base); }
+    Q_REQUIRED_RESULT int toInt(bool *ok = nullptr, int base = 10) const { return toIntegral<int>(ok, base); }
+    Q_REQUIRED_RESULT uint toUInt(bool *ok = nullptr, int base = 10) const { return toIntegral<uint>(ok, base); }
+    Q_REQUIRED_RESULT long toLong(bool *ok = nullptr, int base = 10) const { return toIntegral<long>(ok, base); }
+    Q_REQUIRED_RESULT ulong toULong(bool *ok = nullptr, int base = 10) const { return toIntegral<ulong>(ok, base); }
+    Q_REQUIRED_RESULT qlonglong toLongLong(bool *ok = nullptr, int base = 10) const { return toIntegral<qlonglong>(ok, base); }
+    Q_REQUIRED_RESULT qulonglong toULongLong(bool *ok = nullptr, int base = 10) const { return toIntegral<qulonglong>(ok, base); }
+
+    // inf on overflow and 0 on underflow, with *ok false, like QString::toDouble()
+    Q_REQUIRED_RESULT double toDouble(bool *ok = nullptr) const
+    {
+        double result;
+        const bool valid = QEmuPrivate::parseDouble(rawUtf16(), size(), &result);
+        if (ok)
+            *ok = valid;
+        return result;
+    }
+    // and the float overflow and underflow on top of that, like QString::toFloat()
+    Q_REQUIRED_RESULT float toFloat(bool *ok = nullptr) const
+    {
+        bool valid;
+        const double d = toDouble(&valid);
+        float result = float(d);
+        if (!std::isinf(d) && !std::isnan(d)) {
+            if (std::fabs(d) > std::numeric_limits<float>::max()) {
+                valid = false;
+                result = d < 0 ? -std::numeric_limits<float>::infinity() : std::numeric_limits<float>::infinity();
+            } else if (d != 0 && result == 0) {
+                valid = false;
+            }
+        }
+        if (ok)
+            *ok = valid;
+        return result;
+    }
+
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    // The members above hide QString's; keep its overloads for QLatin1String,
+    // QRegExp and the like reachable.
+    template <typename T>
+    using if_not_view_searchable = typename std::enable_if<!std::is_convertible<const T &, QChar>::value
+                                                           && !std::is_convertible<const T &, QEmuStringView>::value, bool>::type;
+#define QEMUSTRINGVIEW_FORWARD_TO_QSTRING(name) \
+    template <typename T, typename... Args, if_not_view_searchable<T> = true> \
+    auto name(const T &t, Args &&...args) const \
+        -> decltype(std::declval<const QString &>().name(t, std::forward<Args>(args)...)) \
+    { return QString::name(t, std::forward<Args>(args)...); }
+    QEMUSTRINGVIEW_FORWARD_TO_QSTRING(indexOf)
+    QEMUSTRINGVIEW_FORWARD_TO_QSTRING(lastIndexOf)
+    QEMUSTRINGVIEW_FORWARD_TO_QSTRING(contains)
+    QEMUSTRINGVIEW_FORWARD_TO_QSTRING(count)
+    QEMUSTRINGVIEW_FORWARD_TO_QSTRING(startsWith)
+    QEMUSTRINGVIEW_FORWARD_TO_QSTRING(endsWith)
+    QEMUSTRINGVIEW_FORWARD_TO_QSTRING(compare)
+    QEMUSTRINGVIEW_FORWARD_TO_QSTRING(split)
+#undef QEMUSTRINGVIEW_FORWARD_TO_QSTRING
+    Q_REQUIRED_RESULT int count() const { return QString::count(); }
+#endif
+
+    // how many characters of text toPrettyUnicode() writes before it cuts the rest
+    enum { PrettyUnicodeLimit = 245 };
+
+    // Like QTest::toPrettyUnicode(): the string in double quotes, with everything but
+    // printable ASCII escaped, cut after 245 characters and then followed by "...".
+    // The caller delete[]s the result.
+    char *toPrettyUnicode() const
+    {
+        QScopedArrayPointer<char> buffer(new char[256]);
+        const char *end = writePrettyUnicode(rawUtf16(), size(), buffer.data(), PrettyUnicodeLimit);
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteToPrettyUnicode, true, end + 1 - buffer.data());
+        Q_UNUSED(end);
+        return buffer.take();
+    }
+    // The same into buffer, which holds size bytes including the terminating NUL; the
+    // text is cut size - 11 characters in, which keeps the result within size - 1 (for
+    // 256 that is where toPrettyUnicode() cuts). size must be at least 12. Returns the
+    // length of the result.
+    qsizetype toPrettyUnicode(char *buffer, qsizetype size) const Q_DECL_NOTHROW
+    {
+        Q_ASSERT(size >= 12);
+        if (size < 12) {
+            if (size > 0)
+                *buffer = '\0';
+            return 0;
+        }
+        const char *end = writePrettyUnicode(rawUtf16(), this->size(), buffer, size - 11);
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteToPrettyUnicode, false, end + 1 - buffer);
+        return end - buffer;
+    }
+    // The same into out, replacing its contents but reusing its capacity. The text is
+    // cut maxLength characters in, or not at all if maxLength is negative.
+    void toPrettyUnicode(QByteArray &out, qsizetype maxLength = PrettyUnicodeLimit) const
+    {
+        // the text, with every character escaped if need be, the quotes, "..." and NUL
+        const qsizetype escaped = 6 * size();
+        const qsizetype room = (maxLength < 0 ? escaped : qMin(escaped, maxLength + 5) + 3) + 3;
+        const bool allocates = room > out.capacity();
+        out.resize(int(room));
+        const char *end = writePrettyUnicode(rawUtf16(), size(), out.data(), maxLength < 0 ? escaped : maxLength);
+        out.resize(int(end - out.constData()));
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteToPrettyUnicode, allocates, out.size() + 1);
+        Q_UNUSED(allocates);
+    }
+
+private:
+    // every constructor from a (pointer, length) pair ends up here, tagged with
+    // the overload it came from for QEMUSTRINGVIEW_INSTRUMENT
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+template <typename Char, QEmuPrivate::InstrumentationSite Site>
+    QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Char *str, qsizetype len, QEmuPrivate::SiteTag<Site>)
+        : m_size((Q_ASSERT10(len >= 0), Q_ASSERT10(str || !len), len))
+        , m_data(castHelper(str))
+    { QEMUSTRINGVIEW_RECORD(Site, false, 0); }
+#elif defined(QEMUSTRINGVIEW_SSO)
+    // short strings go into m_sso instead of a heap-allocated QString
+template <typename Char, QEmuPrivate::InstrumentationSite Site>
+    inline QEmuStringView(const Char *str, qsizetype len, QEmuPrivate::SiteTag<Site>)
+        : m_data(dataOrNull(str))
+    {
+        const bool allocates = !assignShort(castHelper(str), len);
+        if (allocates)
+            QString::operator=(QString(castHelper(str), int(len)));
+        QEMUSTRINGVIEW_RECORD(Site, allocates && str && len > 0, allocates && str && len > 0 ? len * qsizetype(sizeof(QChar)) : 0);
+    }
+    QEmuStringView(const QChar *str, qsizetype len, QEmuPrivate::SiteTag<QEmuPrivate::SiteSubstring>)
+        : m_data(dataOrNull(str))
+    {
+        const bool allocates = !assignShort(str, len);
+        if (allocates)
+            QString::operator=(str ? QString::fromRawData(str, int(len)) : QString());
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteSubstring, allocates && str && len > 0, 0);
+    }
+    QEmuStringView(const QChar *str, qsizetype len, QEmuPrivate::SiteTag<QEmuPrivate::SiteDecode>)
+        : m_data(dataOrNull(str))
+    {
+        const bool allocates = !assignShort(str, len);
+        if (allocates)
+            QString::operator=(str ? QString::fromRawData(str, int(len)) : QString());
+        QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteDecode, allocates && str && len > 0, 0);
+    }
+#else
+template <typename Char, QEmuPrivate::InstrumentationSite Site>
+    inline QEMUSTRINGVIEW_CONSTEXPR QEmuStringView(const Char *str, qsizetype len, QEmuPrivate::SiteTag<Site>)
+        : QString(castHelper(str),len), m_data(dataOrNull(str))
+    { QEMUSTRINGVIEW_RECORD(Site, str && len > 0, str && len > 0 ? len * qsizetype(sizeof(QChar)) : 0); }
+    // refers to str instead of copying it
+    QEmuStringView(const QChar *str, qsizetype len, QEmuPrivate::SiteTag<QEmuPrivate::SiteSubstring>)
+        : QString(str ? QString::fromRawData(str, int(len)) : QString()), m_data(dataOrNull(str))
+    { QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteSubstring, str && len > 0, 0); }
+    // likewise, for the contents of a QEmuUtf16Buffer or a QEmuStringArena
+    QEmuStringView(const QChar *str, qsizetype len, QEmuPrivate::SiteTag<QEmuPrivate::SiteDecode>)
+        : QString(str ? QString::fromRawData(str, int(len)) : QString()), m_data(dataOrNull(str))
+    { QEMUSTRINGVIEW_RECORD(QEmuPrivate::SiteDecode, str && len > 0, 0); }
+#endif
+
+#if !defined(QEMUSTRINGVIEW_ZEROCOPY) && defined(QEMUSTRINGVIEW_SSO)
+    // Copies [str, str + len) into m_sso and points the QString at it through m_ssoHeader,
+    // a static header like QStringLiteral()'s, which QString never frees or writes to.
+    // Returns false, and does nothing, if the string is null, empty or too long.
+    bool assignShort(const QChar *str, qsizetype len) Q_DECL_NOTHROW
+    {
+        if (!str || len <= 0 || len > SsoCapacity)
+            return false;
+        memcpy(m_sso, str, size_t(len) * sizeof(QChar));
+        m_sso[len] = 0;
+        new (&m_ssoHeader) QArrayData Q_STATIC_STRING_DATA_HEADER_INITIALIZER_WITH_OFFSET(int(len),
+            reinterpret_cast<const char *>(m_sso) - reinterpret_cast<const char *>(&m_ssoHeader));
+        QString::operator=(QString(QStringDataPtr{ static_cast<QStringData *>(&m_ssoHeader) }));
+        return true;
+    }
+    bool isShort() const Q_DECL_NOTHROW
+    { return const_cast<QEmuStringView *>(this)->data_ptr() == static_cast<const QStringData *>(&m_ssoHeader); }
+    // the QString that copies of this view get: their own inline copy if it is short
+    void copyFrom(const QEmuStringView &other) Q_DECL_NOTHROW
+    {
+        if (!other.isShort() || !assignShort(other.QString::constData(), other.QString::size()))
+            QString::operator=(static_cast<const QString &>(other));
+        m_data = other.m_data;
+    }
+#endif
+
+    // QString::toLongLong() and toULongLong() reject values outside 64 bits and,
+    // for the unsigned types, any minus sign; toInt() and the others then reject
+    // what does not fit in their type either
+    template <typename T>
+    T toIntegral(bool *ok, int base) const Q_DECL_NOTHROW
+    {
+        bool negative;
+        qulonglong magnitude;
+        bool valid = QEmuPrivate::parseInteger(rawUtf16(), size(), base, &negative, &magnitude);
+        T result = 0;
+        if (valid && std::is_signed<T>::value) {
+            valid = magnitude <= qulonglong(std::numeric_limits<T>::max()) + negative;
+            // -magnitude without overflowing for the minimum
+            if (valid)
+                result = negative ? T(-T(magnitude - 1) - 1) : T(magnitude);
+        } else if (valid) {
+            valid = !negative && magnitude <= qulonglong(std::numeric_limits<T>::max());
+            if (valid)
+                result = T(magnitude);
+        }
+        if (ok)
+            *ok = valid;
+        return result;
+    }
+
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    // QChar data is 2-byte aligned, so no data is ever at address 1
+    static const void *nullData() Q_DECL_NOTHROW { return reinterpret_cast<const void *>(quintptr(1)); }
+    template <typename Char>
+    static const void *dataOrNull(const Char *str) Q_DECL_NOTHROW { return str ? static_cast<const void *>(str) : nullData(); }
+    bool isNullView() const Q_DECL_NOTHROW { return m_data == nullData(); }
+    bool hasData() const Q_DECL_NOTHROW { return m_data && m_data != nullData(); }
+#endif
+
+    // the kernels in QEmuPrivate work on ushort, whatever storage_type is. They take a
+    // length, so this reads constData(): QString::utf16() would copy a fromRawData()
+    // string, which every slice is in the QString-based mode, to NUL-terminate it.
+    const ushort *rawUtf16() const Q_DECL_NOTHROW { return reinterpret_cast<const ushort *>(constData()); }
+
+    QEmuStringView slice(const QChar *str, qsizetype len) const
+    {
+        return QEmuStringView(str, len, QEmuPrivate::SiteTag<QEmuPrivate::SiteSubstring>());
+    }
+
+    bool matchesAt(qsizetype pos, const QEmuStringView &s, Qt::CaseSensitivity cs) const Q_DECL_NOTHROW
+    { return QEmuPrivate::ucstreq(rawUtf16() + pos, s.size(), s.rawUtf16(), s.size(), cs); }
+
+    friend class QEmuUtf16Buffer;
+    friend class QEmuStringArena;
+    friend class QEmuStringPool;
+    friend class QEmuStringTokenizer;
+    friend class QEmuStringCodePoints;
+    friend class QEmuMappedStringView;
+    friend class QEmuRecordReader;
+    friend class QEmuStringBuilder;
+
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    // sized for the common all-BMP case, grown on the first character that is not
+    static QString fromUcs4Helper(const wchar_t *str, qsizetype len)
+    {
+        const uint *src = reinterpret_cast<const uint *>(str);
+        QString result(int(len), Qt::Uninitialized);
+        ushort *dst = reinterpret_cast<ushort *>(result.data());
+        const qsizetype bmp = QEmuPrivate::qucs4tobmp(src, len, dst);
+        if (bmp < len) {
+            result.resize(int(bmp + 2 * (len - bmp)));
+            dst = reinterpret_cast<ushort *>(result.data());
+            result.resize(int(bmp + QEmuPrivate::ucs4ToUtf16(src + bmp, len - bmp, dst + bmp)));
+        }
+        return result;
+    }
+#endif
+
+    static Q_DECL_CONSTEXPR inline char toHexUpper(uint value) Q_DECL_NOTHROW
+    {
+        return "0123456789ABCDEF"[value & 0xF];
+    }
+
+    // Escaping stops once maxLength characters of text have been written; an escape
+    // sequence can take that to maxLength + 5, so with the quotes, "..." and NUL dst
+    // needs maxLength + 11 bytes. Returns where the NUL went.
+    static char *writePrettyUnicode(const ushort *p, qsizetype length, char *dst, qsizetype maxLength) Q_DECL_NOTHROW
+    {
+        const ushort *end = p + length;
+        bool trimmed = false;
+        *dst++ = '"';
+        char *const text = dst;
         for ( ; p != end; ++p) {
-            if (dst - buffer.data() > 245) {
-                // plus the the quote, the three dots and NUL, it's 250, 251 or 255
+            if (dst - text >= maxLength) {
                 trimmed = true;
                 break;
             }
 
-            if (*p < 0x7f && *p >= 0x20 && *p != '\\' && *p != '"') {
-                *dst++ = *p;
-                continue;
-            }
+            if (*p < 0x7f && *p >= 0x20 && *p != '\\' && *p != '"') {
+#ifdef __SSE2__
+                // the rest of the run in one go, as long as it stays within maxLength
+                const qsizetype run = QEmuPrivate::copyPrintableAscii_sse2(p, qMin(qsizetype(end - p), maxLength - (dst - text)), dst);
+                if (run) {
+                    p += run - 1;
+                    dst += run;
+                    continue;
+                }
+#endif
+                *dst++ = char(*p);
+                continue;
+            }
+
+            // write as an escape sequence
+            *dst++ = '\\';
+            switch (*p) {
+            case 0x22:
+            case 0x5c:
+                *dst++ = char(*p);
+                break;
+            case 0x8:
+                *dst++ = 'b';
+                break;
+            case 0xc:
+                *dst++ = 'f';
+                break;
+            case 0xa:
+                *dst++ = 'n';
+                break;
+            case 0xd:
+                *dst++ = 'r';
+                break;
+            case 0x9:
+                *dst++ = 't';
+                break;
+            default:
+                *dst++ = 'u';
+                *dst++ = toHexUpper(*p >> 12);
+                *dst++ = toHexUpper(*p >> 8);
+                *dst++ = toHexUpper(*p >> 4);
+                *dst++ = toHexUpper(*p);
+            }
+        }
+
+        *dst++ = '"';
+        if (trimmed) {
+            *dst++ = '.';
+            *dst++ = '.';
+            *dst++ = '.';
+        }
+        *dst = '\0';
+        return dst;
+    }
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+    qsizetype m_size;
+    const storage_type *m_data;
+#else
+    // Where the characters came from, if from somewhere other than a QString; else
+    // nullptr, or nullData() for a null view. Together with the QString that is two
+    // pointers, like QStringView.
+    const void *m_data = nullptr;
+#ifdef QEMUSTRINGVIEW_SSO
+    QArrayData m_ssoHeader;
+    ushort m_sso[SsoCapacity + 1];
+#endif
+#endif
+};
+
+// A view costs what a (pointer, length) pair does; with QEMUSTRINGVIEW_ZEROCOPY it also
+// copies like one, so containers can memcpy it and it is passed in registers.
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+Q_STATIC_ASSERT(sizeof(QEmuStringView) == 2 * sizeof(void *));
+#  if !defined(Q_CC_GNU) || defined(Q_CC_CLANG) || Q_CC_GNU >= 500
+Q_STATIC_ASSERT(std::is_trivially_copyable<QEmuStringView>::value);
+#  endif
+Q_DECLARE_TYPEINFO(QEmuStringView, Q_PRIMITIVE_TYPE);
+#elif !defined(QEMUSTRINGVIEW_SSO)
+Q_STATIC_ASSERT(sizeof(QEmuStringView) == 2 * sizeof(void *));
+Q_DECLARE_TYPEINFO(QEmuStringView, Q_MOVABLE_TYPE);
+#endif
+
+// so that view % view % QLatin1String(...) builds its QString with one allocation,
+// like QStringBuilder does for QString pieces
+template <> struct QConcatenable<QEmuStringView> : private QAbstractConcatenable
+{
+    typedef QEmuStringView type;
+    typedef QString ConvertTo;
+    enum { ExactSize = true };
+    static int size(QEmuStringViewArg a) Q_DECL_NOTHROW { return int(a.size()); }
+    static inline void appendTo(QEmuStringViewArg a, QChar *&out) Q_DECL_NOTHROW
+    {
+        const qsizetype n = a.size();
+        if (n)
+            std::memcpy(out, a.constData(), size_t(n) * sizeof(QChar));
+        out += n;
+    }
+};
+
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+namespace QEmuPrivate {
+    // constexpr where the compiler can tell us that it is evaluating a constant expression
+    inline QEMUSTRINGVIEW_COMPARE_CONSTEXPR int compareViews(QEmuStringViewArg lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW
+    {
+        if (QEMUSTRINGVIEW_IS_CONSTANT_EVALUATED())
+            return constexprCompare(lhs.utf16(), lhs.size(), rhs.utf16(), rhs.size());
+        return QEmuStringView::compareHelper(lhs, rhs.utf16(), rhs.size());
+    }
+}
+
+inline QEMUSTRINGVIEW_COMPARE_CONSTEXPR bool operator==(QEmuStringViewArg lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW
+{
+    if (QEMUSTRINGVIEW_IS_CONSTANT_EVALUATED())
+        return lhs.size() == rhs.size() && QEmuPrivate::constexprCompare(lhs.utf16(), lhs.size(), rhs.utf16(), rhs.size()) == 0;
+    return QEmuStringView::equalHelper(lhs, rhs.utf16(), rhs.size());
+}
+inline QEMUSTRINGVIEW_COMPARE_CONSTEXPR bool operator!=(QEmuStringViewArg lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return !(lhs == rhs); }
+inline QEMUSTRINGVIEW_COMPARE_CONSTEXPR bool operator< (QEmuStringViewArg lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return QEmuPrivate::compareViews(lhs, rhs) <  0; }
+inline QEMUSTRINGVIEW_COMPARE_CONSTEXPR bool operator<=(QEmuStringViewArg lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return QEmuPrivate::compareViews(lhs, rhs) <= 0; }
+inline QEMUSTRINGVIEW_COMPARE_CONSTEXPR bool operator> (QEmuStringViewArg lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return QEmuPrivate::compareViews(lhs, rhs) >  0; }
+inline QEMUSTRINGVIEW_COMPARE_CONSTEXPR bool operator>=(QEmuStringViewArg lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return QEmuPrivate::compareViews(lhs, rhs) >= 0; }
+#endif
+
+// None of the following build a temporary QEmuStringView (which would be a deep copy
+// in the QString-based mode); they compare the raw (pointer, length) pairs instead.
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator==(QEmuStringViewArg lhs, const Char rhs) Q_DECL_NOTHROW { return QEmuStringView::equalHelper(lhs, &rhs, 1); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator!=(QEmuStringViewArg lhs, const Char rhs) Q_DECL_NOTHROW { return !QEmuStringView::equalHelper(lhs, &rhs, 1); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator< (QEmuStringViewArg lhs, const Char rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, &rhs, 1) <  0; }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator<=(QEmuStringViewArg lhs, const Char rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, &rhs, 1) <= 0; }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator> (QEmuStringViewArg lhs, const Char rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, &rhs, 1) >  0; }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator>=(QEmuStringViewArg lhs, const Char rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, &rhs, 1) >= 0; }
+
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator==(const Char lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return QEmuStringView::equalHelper(rhs, &lhs, 1); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator!=(const Char lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return !QEmuStringView::equalHelper(rhs, &lhs, 1); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator< (const Char lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 <  QEmuStringView::compareHelper(rhs, &lhs, 1); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator<=(const Char lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 <= QEmuStringView::compareHelper(rhs, &lhs, 1); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator> (const Char lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 >  QEmuStringView::compareHelper(rhs, &lhs, 1); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator>=(const Char lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 >= QEmuStringView::compareHelper(rhs, &lhs, 1); }
+
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator==(QEmuStringViewArg lhs, const Char* rhs) Q_DECL_NOTHROW { return QEmuStringView::equalHelper(lhs, rhs, QEmuStringView::lengthHelperPointer(rhs)); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator!=(QEmuStringViewArg lhs, const Char* rhs) Q_DECL_NOTHROW { return !QEmuStringView::equalHelper(lhs, rhs, QEmuStringView::lengthHelperPointer(rhs)); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator< (QEmuStringViewArg lhs, const Char* rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, rhs, QEmuStringView::lengthHelperPointer(rhs)) <  0; }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator<=(QEmuStringViewArg lhs, const Char* rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, rhs, QEmuStringView::lengthHelperPointer(rhs)) <= 0; }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator> (QEmuStringViewArg lhs, const Char* rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, rhs, QEmuStringView::lengthHelperPointer(rhs)) >  0; }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator>=(QEmuStringViewArg lhs, const Char* rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, rhs, QEmuStringView::lengthHelperPointer(rhs)) >= 0; }
+
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator==(const Char* lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return QEmuStringView::equalHelper(rhs, lhs, QEmuStringView::lengthHelperPointer(lhs)); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator!=(const Char* lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return !QEmuStringView::equalHelper(rhs, lhs, QEmuStringView::lengthHelperPointer(lhs)); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator< (const Char* lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 <  QEmuStringView::compareHelper(rhs, lhs, QEmuStringView::lengthHelperPointer(lhs)); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator<=(const Char* lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 <= QEmuStringView::compareHelper(rhs, lhs, QEmuStringView::lengthHelperPointer(lhs)); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator> (const Char* lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 >  QEmuStringView::compareHelper(rhs, lhs, QEmuStringView::lengthHelperPointer(lhs)); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator>=(const Char* lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 >= QEmuStringView::compareHelper(rhs, lhs, QEmuStringView::lengthHelperPointer(lhs)); }
+
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator==(QEmuStringViewArg lhs, const std::basic_string<Char> & rhs) Q_DECL_NOTHROW { return QEmuStringView::equalHelper(lhs, rhs.data(), qsizetype(rhs.size())); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator!=(QEmuStringViewArg lhs, const std::basic_string<Char> & rhs) Q_DECL_NOTHROW { return !QEmuStringView::equalHelper(lhs, rhs.data(), qsizetype(rhs.size())); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator< (QEmuStringViewArg lhs, const std::basic_string<Char> & rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, rhs.data(), qsizetype(rhs.size())) <  0; }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator<=(QEmuStringViewArg lhs, const std::basic_string<Char> & rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, rhs.data(), qsizetype(rhs.size())) <= 0; }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator> (QEmuStringViewArg lhs, const std::basic_string<Char> & rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, rhs.data(), qsizetype(rhs.size())) >  0; }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator>=(QEmuStringViewArg lhs, const std::basic_string<Char> & rhs) Q_DECL_NOTHROW { return QEmuStringView::compareHelper(lhs, rhs.data(), qsizetype(rhs.size())) >= 0; }
+
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator==(const std::basic_string<Char> & lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return QEmuStringView::equalHelper(rhs, lhs.data(), qsizetype(lhs.size())); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator!=(const std::basic_string<Char> & lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return !QEmuStringView::equalHelper(rhs, lhs.data(), qsizetype(lhs.size())); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator< (const std::basic_string<Char> & lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 <  QEmuStringView::compareHelper(rhs, lhs.data(), qsizetype(lhs.size())); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator<=(const std::basic_string<Char> & lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 <= QEmuStringView::compareHelper(rhs, lhs.data(), qsizetype(lhs.size())); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator> (const std::basic_string<Char> & lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 >  QEmuStringView::compareHelper(rhs, lhs.data(), qsizetype(lhs.size())); }
+template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
+inline bool operator>=(const std::basic_string<Char> & lhs, QEmuStringViewArg rhs) Q_DECL_NOTHROW { return 0 >= QEmuStringView::compareHelper(rhs, lhs.data(), qsizetype(lhs.size())); }
+
+// Bit for bit what qHash(const QString &, seed) returns for the same characters, so
+// that views can be looked up in hashes keyed on QString. Where constant evaluation
+// is supported, views onto literals hash at compile time, to the value Qt gives
+// for seed 0 (a constant expression cannot know whether Qt uses CRC32 for others).
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+inline QEMUSTRINGVIEW_COMPARE_CONSTEXPR uint qHash(QEmuStringViewArg key, uint seed = 0) Q_DECL_NOTHROW
+{
+    if (QEMUSTRINGVIEW_IS_CONSTANT_EVALUATED()) {
+        uint h = seed;
+        for (qsizetype i = 0; i < key.size(); ++i)
+            h = 31 * h + ushort(key.utf16()[i]);
+        return h;
+    }
+    return QEmuPrivate::hashString(reinterpret_cast<const ushort *>(key.utf16()), key.size(), seed);
+}
+#else
+inline uint qHash(const QEmuStringView &key, uint seed = 0) Q_DECL_NOTHROW
+{
+    // not utf16(), which would copy a slice to NUL-terminate it
+    return QEmuPrivate::hashString(reinterpret_cast<const ushort *>(key.constData()), key.size(), seed);
+}
+#endif
+
+/*
+  Lets a view be looked up in a QHash, QMap or QSet keyed on QString without building
+  a QString copy of it:
+
+      const T value = hash.value(QEmuStringViewKey(view));
+
+  It is a QString that refers to the view's characters through a static header, the
+  way QStringLiteral() refers to its literal. It must not outlive the view's data,
+  and it must only be used to look things up: a container that stores a copy of it
+  (insert(), operator[]) would keep a reference to this object's header.
+*/
+class QEmuStringViewKey
+{
+public:
+    explicit QEmuStringViewKey(QEmuStringViewArg view) Q_DECL_NOTHROW
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+        : m_header Q_STATIC_STRING_DATA_HEADER_INITIALIZER_WITH_OFFSET(int(view.size()),
+              reinterpret_cast<const char *>(view.utf16()) - reinterpret_cast<const char *>(&m_header))
+        , m_string(view.isNull() ? QString() : QString(QStringDataPtr{ static_cast<QStringData *>(&m_header) }))
+#else
+        : m_string(view)
+#endif
+    {}
+
+    operator const QString &() const Q_DECL_NOTHROW { return m_string; }
+    const QString &string() const Q_DECL_NOTHROW { return m_string; }
+
+private:
+    Q_DISABLE_COPY(QEmuStringViewKey)
+
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+    QArrayData m_header;
+#endif
+    QString m_string;
+};
+
+// Hash and equality for std::unordered_map and std::unordered_set keyed on QString
+// or QEmuStringView. Both are transparent, so with C++20 find() and count() take a
+// view directly whatever the key type.
+struct QEmuStringViewHash
+{
+    typedef void is_transparent;
+    std::size_t operator()(QEmuStringViewArg s) const Q_DECL_NOTHROW { return qHash(s); }
+};
+struct QEmuStringViewEqual
+{
+    typedef void is_transparent;
+    bool operator()(QEmuStringViewArg lhs, QEmuStringViewArg rhs) const Q_DECL_NOTHROW { return lhs == rhs; }
+};
+
+/*
+  What QEmuStringView::split() returns: the fields of a view between occurrences of
+  a separator, found one at a time as the range is iterated, like Qt 6's
+  QStringTokenizer. The fields are the ones QString::split() would return with the
+  same arguments, in the same order, but as views instead of QStrings in a list.
+  The separator search is QEmuStringView::indexOf()'s, with its SIMD kernels.
+
+      for (QEmuStringView field : line.split(QLatin1Char('\t')))
+          process(field);
+
+  The range refers to the view it was made from and the separator, and its fields
+  to the view's data: none of them may outlive what they refer to. toContainer()
+  and toStringList() collect the fields when a list is needed after all.
+*/
+class QEmuStringTokenizer
+{
+public:
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef QEmuStringView value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const QEmuStringView *pointer;
+        typedef const QEmuStringView &reference;
+
+        const_iterator() Q_DECL_NOTHROW : m_tokenizer(nullptr), m_next(-1), m_extra(0), m_atEnd(true) {}
+
+        reference operator*() const { return m_token; }
+        pointer operator->() const { return &m_token; }
+
+        const_iterator &operator++() { advance(); return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; advance(); return old; }
+
+        friend bool operator==(const const_iterator &lhs, const const_iterator &rhs) Q_DECL_NOTHROW
+        {
+            if (lhs.m_atEnd || rhs.m_atEnd)
+                return lhs.m_atEnd == rhs.m_atEnd;
+            return lhs.m_next == rhs.m_next && lhs.m_extra == rhs.m_extra;
+        }
+        friend bool operator!=(const const_iterator &lhs, const const_iterator &rhs) Q_DECL_NOTHROW
+        { return !(lhs == rhs); }
+
+    private:
+        friend class QEmuStringTokenizer;
+
+        explicit const_iterator(const QEmuStringTokenizer *tokenizer)
+            : m_tokenizer(tokenizer), m_next(0), m_extra(0), m_atEnd(false)
+        { advance(); }
+
+        // the same steps as QString::split(): an empty separator matches between every
+        // two characters, so the search after such a match starts one further along
+        void advance()
+        {
+            const QEmuStringView &s = m_tokenizer->m_string;
+            while (m_next >= 0) {
+                const qsizetype start = m_next;
+                const qsizetype end = m_tokenizer->find(start + m_extra);
+                if (end < 0) {
+                    m_next = -1;
+                } else {
+                    m_next = end + m_tokenizer->m_sepSize;
+                    m_extra = m_tokenizer->m_sepSize == 0;
+                }
+                const qsizetype len = (end < 0 ? s.size() : end) - start;
+                if (len || m_tokenizer->m_keepEmpty) {
+                    m_token = s.slice(s.constData() + start, len);
+                    return;
+                }
+            }
+            m_atEnd = true;
+            m_token = QEmuStringView();
+        }
+
+        const QEmuStringTokenizer *m_tokenizer;
+        QEmuStringView m_token;
+        qsizetype m_next;       // where the field after m_token starts, -1 after the last one
+        qsizetype m_extra;
+        bool m_atEnd;
+    };
+    typedef const_iterator iterator;
+    typedef QEmuStringView value_type;
+
+    QEmuStringTokenizer(QEmuStringViewArg s, QEmuStringViewArg sep, bool keepEmpty, Qt::CaseSensitivity cs) Q_DECL_NOTHROW
+        : m_string(s), m_sep(sep), m_sepSize(sep.size()), m_sepChar(0), m_keepEmpty(keepEmpty), m_cs(cs)
+    {
+        if (m_sepSize == 1)
+            m_sepChar = m_sep.rawUtf16()[0];
+    }
+    QEmuStringTokenizer(QEmuStringViewArg s, QChar sep, bool keepEmpty, Qt::CaseSensitivity cs) Q_DECL_NOTHROW
+        : m_string(s), m_sepSize(1), m_sepChar(sep.unicode()), m_keepEmpty(keepEmpty), m_cs(cs)
+    {}
+
+    const_iterator begin() const { return const_iterator(this); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator end() const Q_DECL_NOTHROW { return const_iterator(); }
+    const_iterator cend() const Q_DECL_NOTHROW { return end(); }
+
+    template <typename Container = QVector<QEmuStringView>>
+    Container toContainer(Container c = Container()) const
+    {
+        for (const QEmuStringView &field : *this)
+            c.push_back(field);
+        return c;
+    }
+    QStringList toStringList() const
+    {
+        QStringList result;
+        for (const QEmuStringView &field : *this)
+            result.append(field.toString());
+        return result;
+    }
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    // so that QStringList list = view.split(...) still compiles where
+    // QEmuStringView::split() used to be QString's
+    operator QStringList() const { return toStringList(); }
+#endif
+
+private:
+    qsizetype find(qsizetype from) const Q_DECL_NOTHROW
+    {
+        if (m_sepSize == 1)
+            return QEmuPrivate::findChar(m_string.rawUtf16(), m_string.size(), from, m_sepChar, m_cs);
+        return QEmuPrivate::findString(m_string.rawUtf16(), m_string.size(), from, m_sep.rawUtf16(), m_sepSize, m_cs);
+    }
+
+    QEmuStringView m_string;
+    QEmuStringView m_sep;
+    qsizetype m_sepSize;
+    ushort m_sepChar;
+    bool m_keepEmpty;
+    Qt::CaseSensitivity m_cs;
+};
+
+inline QEmuStringTokenizer QEmuStringView::split(QEmuStringViewArg sep, QString::SplitBehavior behavior, Qt::CaseSensitivity cs) const
+{ return QEmuStringTokenizer(*this, sep, behavior == QString::KeepEmptyParts, cs); }
+inline QEmuStringTokenizer QEmuStringView::split(QChar sep, QString::SplitBehavior behavior, Qt::CaseSensitivity cs) const
+{ return QEmuStringTokenizer(*this, sep, behavior == QString::KeepEmptyParts, cs); }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+inline QEmuStringTokenizer QEmuStringView::split(QEmuStringViewArg sep, Qt::SplitBehavior behavior, Qt::CaseSensitivity cs) const
+{ return QEmuStringTokenizer(*this, sep, !(behavior & Qt::SkipEmptyParts), cs); }
+inline QEmuStringTokenizer QEmuStringView::split(QChar sep, Qt::SplitBehavior behavior, Qt::CaseSensitivity cs) const
+{ return QEmuStringTokenizer(*this, sep, !(behavior & Qt::SkipEmptyParts), cs); }
+#endif
+
+/*
+  What QEmuStringView::codePoints() returns: a bidirectional range over the code
+  points of a view, as char32_t. A high surrogate followed by a low one is one code
+  point; a surrogate that is not half of such a pair comes out as U+FFFD, which is
+  what QString::toUcs4() would make of it too. position() gives the index, in code
+  units, of the code point an iterator is on.
+
+      for (char32_t c : name.codePoints())
+          if (!isAllowed(c))
+              return false;
+
+  The range refers to the view it was made from, and its iterators to the range;
+  neither may outlive what they refer to. isValidUtf16() tells beforehand whether
+  any U+FFFD would come from a lone surrogate.
+*/
+class QEmuStringCodePoints
+{
+public:
+    class const_iterator
+    {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef char32_t value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const char32_t *pointer;
+        typedef char32_t reference;
+
+        const_iterator() Q_DECL_NOTHROW : m_pos(nullptr), m_begin(nullptr), m_end(nullptr) {}
+
+        char32_t operator*() const Q_DECL_NOTHROW
+        {
+            const ushort u = *m_pos;
+            if (!QChar::isSurrogate(u))
+                return u;
+            if (pairsWithNext())
+                return QChar::surrogateToUcs4(u, m_pos[1]);
+            return QChar::ReplacementCharacter;
+        }
+
+        const_iterator &operator++() Q_DECL_NOTHROW { m_pos += pairsWithNext() ? 2 : 1; return *this; }
+        const_iterator operator++(int) Q_DECL_NOTHROW { const_iterator old = *this; ++*this; return old; }
+        const_iterator &operator--() Q_DECL_NOTHROW
+        {
+            --m_pos;
+            if (QChar::isLowSurrogate(*m_pos) && m_pos != m_begin && QChar::isHighSurrogate(m_pos[-1]))
+                --m_pos;
+            return *this;
+        }
+        const_iterator operator--(int) Q_DECL_NOTHROW { const_iterator old = *this; --*this; return old; }
+
+        qsizetype position() const Q_DECL_NOTHROW { return m_pos - m_begin; }
+
+        friend bool operator==(const const_iterator &lhs, const const_iterator &rhs) Q_DECL_NOTHROW
+        { return lhs.m_pos == rhs.m_pos; }
+        friend bool operator!=(const const_iterator &lhs, const const_iterator &rhs) Q_DECL_NOTHROW
+        { return !(lhs == rhs); }
+
+    private:
+        friend class QEmuStringCodePoints;
+
+        const_iterator(const ushort *pos, const ushort *begin, const ushort *end) Q_DECL_NOTHROW
+            : m_pos(pos), m_begin(begin), m_end(end)
+        {}
+
+        bool pairsWithNext() const Q_DECL_NOTHROW
+        { return QChar::isHighSurrogate(*m_pos) && m_pos + 1 != m_end && QChar::isLowSurrogate(m_pos[1]); }
+
+        const ushort *m_pos;
+        const ushort *m_begin;
+        const ushort *m_end;
+    };
+    typedef const_iterator iterator;
+    typedef char32_t value_type;
+
+    explicit QEmuStringCodePoints(QEmuStringViewArg s) : m_string(s) {}
+
+    const_iterator begin() const Q_DECL_NOTHROW
+    { return const_iterator(m_string.rawUtf16(), m_string.rawUtf16(), m_string.rawUtf16() + m_string.size()); }
+    const_iterator cbegin() const Q_DECL_NOTHROW { return begin(); }
+    const_iterator end() const Q_DECL_NOTHROW
+    {
+        const ushort *const last = m_string.rawUtf16() + m_string.size();
+        return const_iterator(last, m_string.rawUtf16(), last);
+    }
+    const_iterator cend() const Q_DECL_NOTHROW { return end(); }
 
-            // write as an escape sequence
-            // this means we may advance dst to buffer.data() + 246 or 250
-            *dst++ = '\\';
-            switch (*p) {
-            case 0x22:
-            case 0x5c:
-                *dst++ = uchar(*p);
-                break;
-            case 0x8:
-                *dst++ = 'b';
-                break;
-            case 0xc:
-                *dst++ = 'f';
-                break;
-            case 0xa:
-                *dst++ = 'n';
-                break;
-            case 0xd:
-                *dst++ = 'r';
-                break;
-            case 0x9:
-                *dst++ = 't';
-                break;
-            default:
-                *dst++ = 'u';
-                *dst++ = toHexUpper(*p >> 12);
-                *dst++ = toHexUpper(*p >> 8);
-                *dst++ = toHexUpper(*p >> 4);
-                *dst++ = toHexUpper(*p);
-            }
+private:
+    QEmuStringView m_string;
+};
+
+inline QEmuStringCodePoints QEmuStringView::codePoints() const
+{ return QEmuStringCodePoints(*this); }
+
+/*
+  A reusable UTF-16 buffer for turning UTF-8, Latin-1 or wchar_t input into
+  QEmuStringViews without allocating a QString per string. Every conversion call
+  decodes into the same storage, replacing what the previous call put there, so a
+  view it returns is only valid until the next call on the same buffer (or until the
+  buffer is destroyed). Use one buffer per string that has to stay alive at the same
+  time, or call toString() on the view to keep it. The storage only grows; strings
+  of up to Prealloc code units never touch the heap.
+
+  forThread() returns a buffer private to the calling thread, for the common case
+  of decoding one field, using it and moving on to the next.
+*/
+class QEmuUtf16Buffer
+{
+public:
+    enum { Prealloc = 256 };
+
+    QEmuUtf16Buffer() {}
+
+    // *ok, if given, is set to false when the input was not valid UTF-8; the
+    // offending bytes are then decoded as U+FFFD like QString::fromUtf8() does
+    QEmuStringView fromUtf8(const char *str, qsizetype len, bool *ok = nullptr)
+    {
+        if (!str) {
+            if (ok)
+                *ok = true;
+            return QEmuStringView();
         }
+        ushort *dst = storage(len);
+        return view(QEmuPrivate::utf8ToUtf16(reinterpret_cast<const uchar *>(str), len, dst, ok));
+    }
+    QEmuStringView fromUtf8(const QByteArray &ba, bool *ok = nullptr)
+    { return fromUtf8(ba.isNull() ? nullptr : ba.constData(), ba.size(), ok); }
 
-        *dst++ = '"';
-        if (trimmed) {
-            *dst++ = '.';
-            *dst++ = '.';
-            *dst++ = '.';
+    QEmuStringView fromLatin1(const char *str, qsizetype len)
+    {
+        if (!str)
+            return QEmuStringView();
+        QEmuPrivate::latin1ToUtf16(reinterpret_cast<const uchar *>(str), len, storage(len));
+        return view(len);
+    }
+    QEmuStringView fromLatin1(const QByteArray &ba)
+    { return fromLatin1(ba.isNull() ? nullptr : ba.constData(), ba.size()); }
+
+    // Where wchar_t is UTF-16 this returns a view onto str itself (a fromRawData()
+    // one in the QString-based mode, or an inline copy of a short str with
+    // QEMUSTRINGVIEW_SSO) and leaves the buffer alone; where it is UTF-32 it
+    // transcodes into the buffer.
+    QEmuStringView fromWCharArray(const wchar_t *str, qsizetype len)
+    {
+        if (!str)
+            return QEmuStringView();
+        if (sizeof(wchar_t) == sizeof(ushort))
+            return QEmuStringView(reinterpret_cast<const QChar *>(str), len, QEmuPrivate::SiteTag<QEmuPrivate::SiteDecode>());
+        const uint *src = reinterpret_cast<const uint *>(str);
+        return view(QEmuPrivate::ucs4ToUtf16(src, len, storage(2 * len)));
+    }
+    QEmuStringView fromStdWString(const std::wstring &str)
+    { return fromWCharArray(str.data(), qsizetype(str.size())); }
+
+    qsizetype capacity() const Q_DECL_NOTHROW { return m_buffer.capacity(); }
+    void reserve(qsizetype size) { m_buffer.reserve(int(size)); }
+
+    static QEmuUtf16Buffer &forThread()
+    {
+        static thread_local QEmuUtf16Buffer buffer;
+        return buffer;
+    }
+
+private:
+    Q_DISABLE_COPY(QEmuUtf16Buffer)
+
+    // room for len code units
+    ushort *storage(qsizetype len)
+    {
+        if (len > m_buffer.size())
+            m_buffer.resize(int(len));
+        return m_buffer.data();
+    }
+    QEmuStringView view(qsizetype len) const
+    {
+        return QEmuStringView(reinterpret_cast<const QChar *>(m_buffer.constData()), len,
+                              QEmuPrivate::SiteTag<QEmuPrivate::SiteDecode>());
+    }
+
+    QVarLengthArray<ushort, Prealloc> m_buffer;
+};
+
+/*
+  A bump-pointer arena for strings that have to stay alive together, say for the
+  duration of one request: every call copies, decodes or case-maps its input into
+  the arena and returns a QEmuStringView onto the result, which remains valid until
+  reset() or the arena's destruction. Strings are allocated from chunks that grow
+  geometrically from ChunkSize up to MaxChunkSize bytes (a longer string gets a
+  chunk of its own size), so thousands of short strings cost a handful of heap
+  allocations. Each string starts on an Alignment boundary and is null-terminated,
+  so utf16() works and the SIMD kernels start on aligned loads.
+
+  reset() drops all strings at once. It keeps the latest chunk for reuse, so an
+  arena that serves one request after another soon stops allocating altogether.
+  An arena is not thread-safe; use one per thread or per request.
+*/
+class QEmuStringArena
+{
+public:
+    enum { Alignment = 16, ChunkSize = 4096, MaxChunkSize = 1024 * 1024 };
+
+    explicit QEmuStringArena(qsizetype chunkSize = ChunkSize) Q_DECL_NOTHROW
+        : m_nextChunkSize(qMax(chunkSize, qsizetype(Alignment)))
+    {}
+    ~QEmuStringArena()
+    {
+        freeChunks(m_chunks);
+    }
+
+    QEmuStringView copy(QEmuStringViewArg s)
+    {
+        return s.isNull() ? QEmuStringView() : store(s.rawUtf16(), s.size());
+    }
+
+    // *ok, if given, is set to false when the input was not valid UTF-8, as with
+    // QEmuUtf16Buffer::fromUtf8()
+    QEmuStringView fromUtf8(const char *str, qsizetype len, bool *ok = nullptr)
+    {
+        if (!str) {
+            if (ok)
+                *ok = true;
+            return QEmuStringView();
         }
-        *dst++ = '\0';
-        return buffer.take();
+        ushort *dst = allocate(len);
+        const qsizetype decoded = QEmuPrivate::utf8ToUtf16(reinterpret_cast<const uchar *>(str), len, dst, ok);
+        shrink(dst, decoded);
+        return view(dst, decoded);
+    }
+    QEmuStringView fromUtf8(const QByteArray &ba, bool *ok = nullptr)
+    { return fromUtf8(ba.isNull() ? nullptr : ba.constData(), ba.size(), ok); }
+
+    QEmuStringView fromLatin1(const char *str, qsizetype len)
+    {
+        if (!str)
+            return QEmuStringView();
+        ushort *dst = allocate(len);
+        QEmuPrivate::latin1ToUtf16(reinterpret_cast<const uchar *>(str), len, dst);
+        return view(dst, len);
+    }
+    QEmuStringView fromLatin1(const QByteArray &ba)
+    { return fromLatin1(ba.isNull() ? nullptr : ba.constData(), ba.size()); }
+
+    // The same results as QString::toUpper() and friends. ASCII is mapped in place;
+    // other input goes through a temporary QString.
+    QEmuStringView toUpper(QEmuStringViewArg s) { return mapCase(s, Upper); }
+    QEmuStringView toLower(QEmuStringViewArg s) { return mapCase(s, Lower); }
+    QEmuStringView toCaseFolded(QEmuStringViewArg s) { return mapCase(s, CaseFolded); }
+
+    // invalidates every view the arena has handed out
+    void reset() Q_DECL_NOTHROW
+    {
+        if (!m_chunks)
+            return;
+        freeChunks(m_chunks->next);
+        m_chunks->next = nullptr;
+        m_ptr = payload(m_chunks);
+    }
+
+    // bytes in chunks, used or not
+    qsizetype capacity() const Q_DECL_NOTHROW
+    {
+        qsizetype total = 0;
+        for (const Chunk *chunk = m_chunks; chunk; chunk = chunk->next)
+            total += chunk->size;
+        return total;
     }
 
 private:
+    Q_DISABLE_COPY(QEmuStringArena)
+    friend class QEmuStringPool;
+    friend class QEmuStringBuilder;
 
-    static Q_DECL_CONSTEXPR inline char toHexUpper(uint value) Q_DECL_NOTHROW
+    struct Chunk {
+        Chunk *next;
+        qsizetype size;
+    };
+    enum { HeaderSize = (sizeof(Chunk) + Alignment - 1) & ~(Alignment - 1) };
+    enum CaseMapping { Upper, Lower, CaseFolded };
+
+    static qsizetype roundUp(qsizetype bytes) Q_DECL_NOTHROW
+    { return (bytes + Alignment - 1) & ~qsizetype(Alignment - 1); }
+    static char *payload(Chunk *chunk) Q_DECL_NOTHROW
+    { return reinterpret_cast<char *>(chunk) + HeaderSize; }
+
+    static void freeChunks(Chunk *chunk) Q_DECL_NOTHROW
     {
-        return "0123456789ABCDEF"[value & 0xF];
+        while (chunk) {
+            Chunk *next = chunk->next;
+            qFreeAligned(chunk);
+            chunk = next;
+        }
     }
-    bool m_isNull = false;
-    bool m_hasData = false;
-    const void *m_data = nullptr;
+
+    // room for len code units and a terminating null
+    ushort *allocate(qsizetype len)
+    {
+        Q_ASSERT(len >= 0);
+        const qsizetype bytes = roundUp((len + 1) * qsizetype(sizeof(ushort)));
+        if (!m_chunks || bytes > payload(m_chunks) + m_chunks->size - m_ptr)
+            grow(bytes);
+        ushort *dst = reinterpret_cast<ushort *>(m_ptr);
+        m_ptr += bytes;
+        dst[len] = 0;
+        return dst;
+    }
+    // Hands back the tail of the latest allocation past its first len code units.
+    // The latest allocation is always at the end of the current chunk.
+    void shrink(ushort *dst, qsizetype len) Q_DECL_NOTHROW
+    {
+        m_ptr = reinterpret_cast<char *>(dst) + roundUp((len + 1) * qsizetype(sizeof(ushort)));
+        dst[len] = 0;
+    }
+    // what is left of the current chunk is abandoned
+    void grow(qsizetype bytes)
+    {
+        const qsizetype size = qMax(bytes, m_nextChunkSize);
+        Chunk *chunk = static_cast<Chunk *>(qMallocAligned(size_t(HeaderSize + size), Alignment));
+        Q_CHECK_PTR(chunk);
+        chunk->next = m_chunks;
+        chunk->size = size;
+        m_chunks = chunk;
+        m_ptr = payload(chunk);
+        m_nextChunkSize = qMin(2 * m_nextChunkSize, qsizetype(MaxChunkSize));
+    }
+
+    QEmuStringView store(const ushort *src, qsizetype len)
+    {
+        ushort *dst = allocate(len);
+        if (len)
+            std::memcpy(dst, src, size_t(len) * sizeof(ushort));
+        return view(dst, len);
+    }
+    QEmuStringView mapCase(QEmuStringViewArg s, CaseMapping mapping)
+    {
+        if (s.isNull())
+            return QEmuStringView();
+        const ushort *src = s.rawUtf16();
+        const qsizetype len = s.size();
+        ushort *dst = allocate(len);
+        if (QEmuPrivate::mapAsciiCase(src, len, dst, mapping == Upper) == len)
+            return view(dst, len);
+        m_ptr = reinterpret_cast<char *>(dst);
+        const QString raw = QString::fromRawData(reinterpret_cast<const QChar *>(src), int(len));
+        const QString mapped = mapping == Upper ? raw.toUpper() : mapping == Lower ? raw.toLower() : raw.toCaseFolded();
+        return store(reinterpret_cast<const ushort *>(mapped.constData()), mapped.size());
+    }
+    static QEmuStringView view(const ushort *str, qsizetype len)
+    {
+        return QEmuStringView(reinterpret_cast<const QChar *>(str), len,
+                              QEmuPrivate::SiteTag<QEmuPrivate::SiteDecode>());
+    }
+
+    Chunk *m_chunks = nullptr;
+    char *m_ptr = nullptr;
+    qsizetype m_nextChunkSize;
 };
 
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator==(QEmuStringView lhs, const Char rhs) Q_DECL_NOTHROW { return lhs == QEmuStringView(rhs,1); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator!=(QEmuStringView lhs, const Char rhs) Q_DECL_NOTHROW { return lhs != QEmuStringView(rhs,1); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator< (QEmuStringView lhs, const Char rhs) Q_DECL_NOTHROW { return lhs <  QEmuStringView(rhs,1); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator<=(QEmuStringView lhs, const Char rhs) Q_DECL_NOTHROW { return lhs <= QEmuStringView(rhs,1); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator> (QEmuStringView lhs, const Char rhs) Q_DECL_NOTHROW { return lhs >  QEmuStringView(rhs,1); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator>=(QEmuStringView lhs, const Char rhs) Q_DECL_NOTHROW { return lhs >= QEmuStringView(rhs,1); }
+/*
+  An interning table. intern() returns one canonical view per distinct string, onto
+  a copy that the pool keeps until it is destroyed, and id() numbers the distinct
+  strings from 0 in the order they were first seen. Interned strings can then be
+  compared by identity: two views interned by the same pool are equal if and only
+  if their data() pointers are, two ids if and only if they are the same id.
 
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator==(const Char lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs,1) == rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator!=(const Char lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs,1) != rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator< (const Char lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs,1) <  rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator<=(const Char lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs,1) <= rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator> (const Char lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs,1) >  rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator>=(const Char lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs,1) >= rhs; }
+  Looking up a string that is already there takes no lock, so many threads can
+  intern and look up known identifiers at once. The table is an open-addressing
+  array of atomic pointers that is only ever filled in; adding a string takes a
+  mutex, and growing copies the table into one twice its size, which readers pick
+  up the next time round. The tables grown out of are kept until the pool goes,
+  which at most doubles the memory the table takes.
 
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator==(QEmuStringView lhs, const Char* rhs) Q_DECL_NOTHROW { return lhs == QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator!=(QEmuStringView lhs, const Char* rhs) Q_DECL_NOTHROW { return lhs != QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator< (QEmuStringView lhs, const Char* rhs) Q_DECL_NOTHROW { return lhs <  QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator<=(QEmuStringView lhs, const Char* rhs) Q_DECL_NOTHROW { return lhs <= QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator> (QEmuStringView lhs, const Char* rhs) Q_DECL_NOTHROW { return lhs >  QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator>=(QEmuStringView lhs, const Char* rhs) Q_DECL_NOTHROW { return lhs >= QEmuStringView(rhs); }
+  Anything a QEmuStringView can be constructed from can be interned or looked up as
+  it is, without constructing a QEmuStringView (which in the QString-based mode
+  would copy pointers and std::basic_strings).
+*/
+class QEmuStringPool
+{
+    struct Key {
+        const ushort *data;
+        qsizetype size;
+    };
 
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator==(const Char* lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) == rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator!=(const Char* lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) != rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator< (const Char* lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) <  rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator<=(const Char* lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) <= rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator> (const Char* lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) >  rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator>=(const Char* lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) >= rhs; }
+    template <typename Pointer, QEmuStringView::if_compatible_pointer<Pointer> = true>
+    static Key keyOf(const Pointer &str) Q_DECL_NOTHROW
+    { return { reinterpret_cast<const ushort *>(str), QEmuStringView::lengthHelperPointer(str) }; }
+    template <typename Array, QEmuStringView::if_compatible_array<Array> = true>
+    static Key keyOf(const Array &str) Q_DECL_NOTHROW
+    { return { reinterpret_cast<const ushort *>(str), QEmuStringView::lengthHelperArray(str) }; }
+    template <typename String, QEmuStringView::if_compatible_qstring_like<String> = true>
+    static Key keyOf(const String &str) Q_DECL_NOTHROW
+    { return { str.isNull() ? nullptr : reinterpret_cast<const ushort *>(str.data()), qsizetype(str.size()) }; }
+    template <typename StdBasicString, QEmuStringView::if_compatible_string<StdBasicString> = true>
+    static Key keyOf(const StdBasicString &str) Q_DECL_NOTHROW
+    { return { reinterpret_cast<const ushort *>(str.data()), qsizetype(str.size()) }; }
+    static Key keyOf(QEmuStringViewArg str) Q_DECL_NOTHROW
+    { return { str.isNull() ? nullptr : str.rawUtf16(), str.size() }; }
 
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator==(QEmuStringView lhs, const std::basic_string<Char> rhs) Q_DECL_NOTHROW { return lhs == QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator!=(QEmuStringView lhs, const std::basic_string<Char> rhs) Q_DECL_NOTHROW { return lhs != QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator< (QEmuStringView lhs, const std::basic_string<Char> rhs) Q_DECL_NOTHROW { return lhs <  QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator<=(QEmuStringView lhs, const std::basic_string<Char> rhs) Q_DECL_NOTHROW { return lhs <= QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator> (QEmuStringView lhs, const std::basic_string<Char> rhs) Q_DECL_NOTHROW { return lhs >  QEmuStringView(rhs); }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator>=(QEmuStringView lhs, const std::basic_string<Char> rhs) Q_DECL_NOTHROW { return lhs >= QEmuStringView(rhs); }
+public:
+    QEmuStringPool()
+        : m_table(newTable(InitialTableSize, nullptr))
+    {
+        for (auto &segment : m_segments)
+            segment.store(nullptr, std::memory_order_relaxed);
+    }
+    ~QEmuStringPool()
+    {
+        const int count = size();
+        for (int id = 0; id < count; ++id)
+            delete entry(id);
+        for (auto &segment : m_segments)
+            delete[] segment.load(std::memory_order_relaxed);
+        for (Table *table = m_table.load(std::memory_order_relaxed); table; ) {
+            Table *previous = table->previous;
+            delete[] table->slots;
+            delete table;
+            table = previous;
+        }
+    }
 
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator==(const std::basic_string<Char> lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) == rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator!=(const std::basic_string<Char> lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) != rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator< (const std::basic_string<Char> lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) <  rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator<=(const std::basic_string<Char> lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) <= rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator> (const std::basic_string<Char> lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) >  rhs; }
-template <typename Char, QEmuStringView::if_compatible_char<Char> = true>
-inline bool operator>=(const std::basic_string<Char> lhs, QEmuStringView rhs) Q_DECL_NOTHROW { return QEmuStringView(lhs) >= rhs; }
+    // the canonical view of str, which is added if it is new; null if str is null
+template <typename String>
+    auto intern(const String &str) -> decltype(keyOf(str), QEmuStringView())
+    {
+        const Key key = keyOf(str);
+        return key.data ? insert(key)->view : QEmuStringView();
+    }
+    // the id of str, which is added if it is new; -1 if str is null
+template <typename String>
+    auto id(const String &str) -> decltype(keyOf(str), int())
+    {
+        const Key key = keyOf(str);
+        return key.data ? insert(key)->id : -1;
+    }
+
+    // lookups that leave the pool alone: -1 or a null view if str was never interned
+template <typename String>
+    auto indexOf(const String &str) const -> decltype(keyOf(str), int())
+    {
+        const Entry *e = lookup(keyOf(str));
+        return e ? e->id : -1;
+    }
+template <typename String>
+    auto find(const String &str) const -> decltype(keyOf(str), QEmuStringView())
+    {
+        const Entry *e = lookup(keyOf(str));
+        return e ? e->view : QEmuStringView();
+    }
+template <typename String>
+    auto contains(const String &str) const -> decltype(keyOf(str), bool())
+    { return lookup(keyOf(str)) != nullptr; }
+
+    // the string with the given id, which must be below size()
+    QEmuStringView at(int id) const
+    {
+        Q_ASSERT(id >= 0 && id < size());
+        return entry(id)->view;
+    }
+
+    int size() const Q_DECL_NOTHROW { return m_count.load(std::memory_order_acquire); }
+    bool isEmpty() const Q_DECL_NOTHROW { return !size(); }
+
+private:
+    Q_DISABLE_COPY(QEmuStringPool)
+
+    // key holds the characters of view as they were stored: lookups compare against
+    // that and never touch the view, which other threads may be reading too
+    struct Entry {
+        QEmuStringView view;
+        Key key;
+        uint hash;
+        int id;
+        bool matches(uint h, Key k) const Q_DECL_NOTHROW
+        { return hash == h && QEmuPrivate::ucstreq(key.data, key.size, k.data, k.size); }
+    };
+    // tables are only replaced, never freed, while the pool is alive
+    struct Table {
+        Table *previous;
+        qsizetype mask;
+        std::atomic<Entry *> *slots;
+    };
+    // Entries are also listed by id, in segments of FirstSegmentSize, twice that,
+    // four times that and so on, which never move once they have been allocated.
+    enum { InitialTableSize = 64, FirstSegmentSize = 64, SegmentCount = 26 };
+
+    static Table *newTable(qsizetype size, Table *previous)
+    {
+        Table *table = new Table;
+        table->previous = previous;
+        table->mask = size - 1;
+        table->slots = new std::atomic<Entry *>[size];
+        for (qsizetype i = 0; i < size; ++i)
+            table->slots[i].store(nullptr, std::memory_order_relaxed);
+        return table;
+    }
+
+    static int segmentOf(int id, int *offset) Q_DECL_NOTHROW
+    {
+        const int segment = 31 - int(qCountLeadingZeroBits(quint32(id / FirstSegmentSize + 1)));
+        *offset = id - FirstSegmentSize * ((1 << segment) - 1);
+        return segment;
+    }
+    Entry *entry(int id) const Q_DECL_NOTHROW
+    {
+        int offset;
+        const int segment = segmentOf(id, &offset);
+        return m_segments[segment].load(std::memory_order_acquire)[offset];
+    }
+
+    const Entry *lookup(Key key) const Q_DECL_NOTHROW
+    {
+        if (!key.data)
+            return nullptr;
+        const uint hash = QEmuPrivate::hashString(key.data, key.size, 0);
+        const Table *table = m_table.load(std::memory_order_acquire);
+        for (qsizetype i = hash & table->mask; ; i = (i + 1) & table->mask) {
+            const Entry *e = table->slots[i].load(std::memory_order_acquire);
+            if (!e)
+                return nullptr;
+            if (e->matches(hash, key))
+                return e;
+        }
+    }
+
+    const Entry *insert(Key key)
+    {
+        if (const Entry *e = lookup(key))
+            return e;
+        const uint hash = QEmuPrivate::hashString(key.data, key.size, 0);
+        QMutexLocker locker(&m_mutex);
+        // only writers replace the table, and they hold the mutex
+        Table *table = m_table.load(std::memory_order_relaxed);
+        const int count = m_count.load(std::memory_order_relaxed);
+        qsizetype i = hash & table->mask;
+        for ( ; ; i = (i + 1) & table->mask) {
+            const Entry *e = table->slots[i].load(std::memory_order_relaxed);
+            if (!e)
+                break;
+            if (e->matches(hash, key))
+                return e;
+        }
+        // keep the table at most half full, so that probe sequences stay short
+        if (2 * (qsizetype(count) + 1) > table->mask + 1) {
+            table = grow(table);
+            for (i = hash & table->mask; table->slots[i].load(std::memory_order_relaxed); i = (i + 1) & table->mask) {}
+        }
+
+        int offset;
+        const int segment = segmentOf(count, &offset);
+        Entry **entries = m_segments[segment].load(std::memory_order_relaxed);
+        if (!entries) {
+            entries = new Entry *[FirstSegmentSize << segment];
+            m_segments[segment].store(entries, std::memory_order_release);
+        }
+        const QEmuStringView stored = m_storage.store(key.data, key.size);
+        Entry *e = new Entry{ stored, Key{ stored.rawUtf16(), stored.size() }, hash, count };
+        entries[offset] = e;
+        table->slots[i].store(e, std::memory_order_release);
+        m_count.store(count + 1, std::memory_order_release);
+        return e;
+    }
+
+    Table *grow(Table *table)
+    {
+        Table *bigger = newTable(2 * (table->mask + 1), table);
+        for (qsizetype j = 0; j <= table->mask; ++j) {
+            Entry *e = table->slots[j].load(std::memory_order_relaxed);
+            if (!e)
+                continue;
+            qsizetype i = e->hash & bigger->mask;
+            while (bigger->slots[i].load(std::memory_order_relaxed))
+                i = (i + 1) & bigger->mask;
+            bigger->slots[i].store(e, std::memory_order_relaxed);
+        }
+        m_table.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    std::atomic<Table *> m_table;
+    std::atomic<Entry **> m_segments[SegmentCount];
+    std::atomic<int> m_count { 0 };
+    QMutex m_mutex;
+    QEmuStringArena m_storage;
+};
+
+/*
+  Collects the pieces of a string, views, Latin-1 strings and characters, and then
+  writes them out in one go: toString() allocates a QString of exactly the total
+  length, appendTo() grows a QString at most once, and toView() writes into a
+  QEmuStringArena. Like QStringBuilder, the builder refers to the pieces it was given
+  instead of copying them, so they must stay alive until it is written out; the
+  exceptions are temporary QStrings and, in the QString-based mode, temporary views,
+  whose characters it keeps a copy of. Up to Prealloc pieces, and 256 such copied
+  characters, need no allocation of their own.
+*/
+class QEmuStringBuilder
+{
+public:
+    enum { Prealloc = 32 };
+
+    QEmuStringBuilder() Q_DECL_NOTHROW : m_size(0) {}
+
+    QEmuStringBuilder &append(QEmuStringViewArg s)
+    { return add(s.rawUtf16(), s.size(), Utf16); }
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    // a temporary view owns its characters, which are gone by the time they are written
+    QEmuStringBuilder &append(QEmuStringView &&s)
+    { return keep(s.rawUtf16(), s.size()); }
+#endif
+    QEmuStringBuilder &append(const QString &s)
+    { return add(s.constData(), s.size(), Utf16); }
+    QEmuStringBuilder &append(QString &&s)
+    { return keep(reinterpret_cast<const ushort *>(s.constData()), s.size()); }
+    QEmuStringBuilder &append(QLatin1String s)
+    { return add(s.data(), s.size(), Latin1); }
+    QEmuStringBuilder &append(QChar c)
+    {
+        Piece piece = { nullptr, 1, c.unicode(), Char };
+        m_pieces.append(piece);
+        ++m_size;
+        return *this;
+    }
+    QEmuStringBuilder &append(QLatin1Char c)
+    { return append(QChar(c)); }
+
+    template <typename T>
+    QEmuStringBuilder &operator<<(T &&piece)
+    { return append(std::forward<T>(piece)); }
+
+    // the length of the result, in code units
+    qsizetype size() const Q_DECL_NOTHROW { return m_size; }
+    bool isEmpty() const Q_DECL_NOTHROW { return m_size == 0; }
+    void clear() Q_DECL_NOTHROW
+    {
+        m_pieces.clear();
+        m_kept.clear();
+        m_size = 0;
+    }
+
+    QString toString() const
+    {
+        if (m_pieces.isEmpty())
+            return QString();
+        QString result(int(m_size), Qt::Uninitialized);
+        writeTo(reinterpret_cast<ushort *>(result.data()));
+        return result;
+    }
+    void appendTo(QString &out) const
+    {
+        const int offset = out.size();
+        out.resize(offset + int(m_size));
+        writeTo(reinterpret_cast<ushort *>(out.data()) + offset);
+    }
+    QEmuStringView toView(QEmuStringArena &arena) const
+    {
+        if (m_pieces.isEmpty())
+            return QEmuStringView();
+        ushort *dst = arena.allocate(m_size);
+        writeTo(dst);
+        return QEmuStringArena::view(dst, m_size);
+    }
+
+private:
+    enum Kind { Utf16, Latin1, Char, Kept };
+    struct Piece {
+        const void *data;       // for Kept pieces, the offset into m_kept
+        qsizetype size;
+        ushort ch;
+        uchar kind;
+    };
+
+    QEmuStringBuilder &add(const void *data, qsizetype size, Kind kind)
+    {
+        Piece piece = { data, size, 0, uchar(kind) };
+        m_pieces.append(piece);
+        m_size += size;
+        return *this;
+    }
+    // by offset rather than pointer, as m_kept can move when it grows
+    QEmuStringBuilder &keep(const ushort *data, qsizetype size)
+    {
+        Piece piece = { reinterpret_cast<const void *>(quintptr(m_kept.size())), size, 0, Kept };
+        m_kept.append(data, int(size));
+        m_pieces.append(piece);
+        m_size += size;
+        return *this;
+    }
+
+    void writeTo(ushort *dst) const Q_DECL_NOTHROW
+    {
+        for (const Piece &piece : m_pieces) {
+            switch (piece.kind) {
+            case Utf16:
+                if (piece.size)
+                    std::memcpy(dst, piece.data, size_t(piece.size) * sizeof(ushort));
+                break;
+            case Latin1:
+                QEmuPrivate::latin1ToUtf16(static_cast<const uchar *>(piece.data), piece.size, dst);
+                break;
+            case Char:
+                *dst = piece.ch;
+                break;
+            case Kept:
+                if (piece.size)
+                    std::memcpy(dst, m_kept.constData() + quintptr(piece.data), size_t(piece.size) * sizeof(ushort));
+                break;
+            }
+            dst += piece.size;
+        }
+    }
+
+    QVarLengthArray<Piece, Prealloc> m_pieces;
+    QVarLengthArray<ushort, 256> m_kept;
+    qsizetype m_size;
+};
 
 #ifndef QSTRINGVIEW_H
     namespace QTest
@@ -537,8 +4171,13 @@ inline bool operator>=(const std::basic_string<Char> lhs, QEmuStringView rhs) Q_
 #ifdef QSTRINGVIEW_EMULATE
 #define QStringView QEmuStringView
 #undef QStringViewLiteral
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+// a view onto a temporary QString would dangle
+#define QStringViewLiteral(str) QStringView(QT_UNICODE_LITERAL(str))
+#else
 #define QStringViewLiteral(str) QStringView(QStringLiteral(str))
 #endif
+#endif
 
 // added by RJVB
 template <typename String, QEmuStringView::if_compatible_qstringview_like<String> = true>
@@ -548,5 +4187,12 @@ inline QDebug operator << (QDebug d, const String* q)
     return d.space();
 }
 
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+inline QDebug operator<<(QDebug d, QEmuStringView s)
+{
+    return d << QString::fromRawData(s.data(), int(s.size()));
+}
+#endif
+
 #endif // QEMUSTRINGVIEW_H
 
@@ -0,0 +1,627 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 René J.V. Bertin <gmail:rjvbertin>
+** Contact: gmail:rjvbertin
+**
+** This file is an extension for the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QEMUSTRINGVIEWALGORITHMS_H
+#define QEMUSTRINGVIEWALGORITHMS_H
+
+#include "qemustringview.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+  Bulk operations over large arrays of QEmuStringViews, spread over a pool of
+  std::threads:
+
+  QEmuParallel::sort() orders views like operator< does, by UTF-16 code unit. It
+  splits the input into buckets around sampled splitters, then sorts each bucket
+  with an MSD radix sort that looks at one byte of a code unit per pass and hands
+  small groups to a comparison sort. Strings are never copied; only their
+  (pointer, length) pairs move.
+
+  QEmuParallel::unique() drops adjacent duplicates from a sorted range, dedup()
+  sorts and then does that to a container.
+
+  QEmuParallel::findAll() returns the indexes of the views that contain a string.
+
+  threadCount is the number of threads to use, the calling thread included; 0
+  means std::thread::hardware_concurrency(). Inputs too small to be worth
+  splitting are handled on the calling thread.
+*/
+
+namespace QEmuPrivate {
+
+    // A fork-join pool in which every thread has a deque of tasks: it runs its own
+    // newest task first and, when it has none left, steals the oldest one of another
+    // thread, or sleeps until a task is pushed. run() returns once every task has
+    // finished, including those that tasks spawned while running.
+    class WorkStealingPool
+    {
+    public:
+        typedef std::function<void()> Task;
+
+        explicit WorkStealingPool(int threadCount)
+            : m_pending(0)
+        {
+            for (int i = 0; i < threadCount; ++i)
+                m_queues.emplace_back(new Queue);
+        }
+
+        int threadCount() const Q_DECL_NOTHROW { return int(m_queues.size()); }
+
+        // before run(): tasks are dealt out to the threads in turn
+        void add(Task task)
+        {
+            push(m_next++ % m_queues.size(), std::move(task));
+        }
+        // from a running task: the task goes to the front of the current thread's queue
+        void spawn(Task task)
+        {
+            push(currentThread(), std::move(task));
+        }
+
+        void run()
+        {
+            const int outer = currentThread();
+            std::vector<std::thread> threads;
+            for (int i = 1; i < threadCount(); ++i)
+                threads.emplace_back([this, i]() { work(i); });
+            work(0);
+            for (std::thread &thread : threads)
+                thread.join();
+            currentThread() = outer;
+        }
+
+        static int idealThreadCount(int requested) Q_DECL_NOTHROW
+        {
+            if (requested > 0)
+                return requested;
+            return qMax(int(std::thread::hardware_concurrency()), 1);
+        }
+
+    private:
+        Q_DISABLE_COPY(WorkStealingPool)
+
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        static int &currentThread() Q_DECL_NOTHROW
+        {
+            static thread_local int index = 0;
+            return index;
+        }
+
+        void push(size_t thread, Task task)
+        {
+            m_pending.fetch_add(1, std::memory_order_relaxed);
+            Queue &queue = *m_queues[thread];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(std::move(task));
+            }
+            wake(false);
+        }
+
+        // a thread that found nothing to take before this sees a new generation
+        void wake(bool all)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_idleMutex);
+                ++m_generation;
+            }
+            if (all)
+                m_idle.notify_all();
+            else
+                m_idle.notify_one();
+        }
+
+        bool take(int self, Task &task)
+        {
+            {
+                Queue &own = *m_queues[size_t(self)];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty()) {
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < m_queues.size(); ++i) {
+                Queue &victim = *m_queues[(size_t(self) + i) % m_queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void work(int self)
+        {
+            currentThread() = self;
+            Task task;
+            quint64 seen = 0;
+            for (;;) {
+                if (take(self, task)) {
+                    task();
+                    task = nullptr;
+                    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        wake(true);     // that was the last one
+                    continue;
+                }
+                // rather than spin while another thread works through a big task, wait
+                // for a push since the last look, or for the last task to finish
+                std::unique_lock<std::mutex> lock(m_idleMutex);
+                if (m_pending.load(std::memory_order_acquire) == 0)
+                    return;
+                m_idle.wait(lock, [this, seen]() {
+                    return m_generation != seen || m_pending.load(std::memory_order_acquire) == 0;
+                });
+                seen = m_generation;
+            }
+        }
+
+        std::vector<std::unique_ptr<Queue> > m_queues;
+        std::atomic<qsizetype> m_pending;
+        size_t m_next = 0;
+        std::mutex m_idleMutex;
+        std::condition_variable m_idle;
+        quint64 m_generation = 0;   // bumped by every push, under m_idleMutex
+    };
+
+    // calls body(begin, end) for consecutive slices of [0, count) on threadCount
+    // threads, in slices of at least grain elements
+    template <typename Body>
+    void parallelFor(qsizetype count, int threadCount, qsizetype grain, const Body &body)
+    {
+        if (threadCount <= 1 || count <= grain) {
+            if (count > 0)
+                body(qsizetype(0), count);
+            return;
+        }
+        // a few slices per thread, so that stealing can even out slow ones
+        const qsizetype slice = qMax(grain, (count + 4 * threadCount - 1) / (4 * threadCount));
+        WorkStealingPool pool(threadCount);
+        for (qsizetype begin = 0; begin < count; begin += slice) {
+            const qsizetype end = qMin(begin + slice, count);
+            pool.add([&body, begin, end]() { body(begin, end); });
+        }
+        pool.run();
+    }
+
+    // what the sort moves around in place of the views themselves
+    struct SortKey {
+        const ushort *data;
+        qsizetype size;
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+        qsizetype index;    // of the view, which cannot be rebuilt from data without a copy
+#endif
+    };
+
+    inline bool sortKeyLess(const SortKey &a, const SortKey &b) Q_DECL_NOTHROW
+    {
+        return ucstrcmp(a.data, a.size, b.data, b.size) < 0;
+    }
+
+    // The radix sort looks at code units a byte at a time: the high byte at even
+    // depths, the low byte at odd ones. unit is the code unit at depth / 2 plus one,
+    // or 0 for keys that end before it, which thus sort first.
+    inline uint radixBucket(uint unit, qsizetype depth) Q_DECL_NOTHROW
+    {
+        if (!unit)
+            return 0;
+        return 1 + ((depth & 1) ? ((unit - 1) & 0xff) : ((unit - 1) >> 8));
+    }
+
+    // The (even) depth after the code units that keys all have in common from the
+    // even depth on. Paths and identifiers share long prefixes, which are better
+    // skipped in one go than a pass per byte.
+    inline qsizetype sharedPrefixDepth(const SortKey *keys, qsizetype count, qsizetype depth) Q_DECL_NOTHROW
+    {
+        const qsizetype unit = depth / 2;
+        qsizetype shared = keys[0].size - unit;
+        for (qsizetype i = 1; i < count && shared > 0; ++i)
+            shared = ucstrmismatch(keys[0].data + unit, keys[i].data + unit, qMin(shared, keys[i].size - unit));
+        return 2 * (unit + qMax(shared, qsizetype(0)));
+    }
+
+    enum {
+        RadixBuckets = 257,
+        // below this many keys a comparison sort wins over another radix pass
+        RadixCutoff = 64,
+        // buckets with more keys than this get their own task
+        RadixSpawnSize = 1 << 14
+    };
+
+    // a group of keys whose first depth bytes are all the same, with the parts of
+    // scratch and units that go with it
+    struct RadixRange {
+        SortKey *keys;
+        SortKey *scratch;
+        uint *units;
+        qsizetype count;
+        qsizetype depth;
+    };
+
+    inline void radixSort(SortKey *keys, SortKey *scratch, uint *units, qsizetype count, qsizetype depth,
+                          WorkStealingPool *pool);
+
+    // Sorts one range. It keeps going with the largest bucket of every pass and leaves
+    // the others, which hold at most half the keys each, in pending or hands them to
+    // pool if they are large, so nothing here recurses.
+    inline void radixSortRange(RadixRange r, std::vector<RadixRange> &pending, WorkStealingPool *pool)
+    {
+        qsizetype counts[RadixBuckets];
+        qsizetype offsets[RadixBuckets];
+        for (;;) {
+            if (r.count <= RadixCutoff) {
+                const qsizetype skip = r.depth / 2;
+                std::sort(r.keys, r.keys + r.count, [skip](const SortKey &a, const SortKey &b) {
+                    return ucstrcmp(a.data + skip, a.size - skip, b.data + skip, b.size - skip) < 0;
+                });
+                return;
+            }
+
+            // the strings are all over memory, so read each one once per code unit and
+            // take both of its bytes from units
+            const qsizetype unit = r.depth / 2;
+            for (qsizetype i = 0; i < r.count; ++i)
+                r.units[i] = unit < r.keys[i].size ? uint(r.keys[i].data[unit]) + 1 : 0;
+            bool split = false;
+            for (;;) {
+                std::fill_n(counts, int(RadixBuckets), qsizetype(0));
+                for (qsizetype i = 0; i < r.count; ++i)
+                    ++counts[radixBucket(r.units[i], r.depth)];
+                if (counts[0] == r.count)
+                    return;     // all of them ended here, so they are equal
+                uint only = 0;
+                while (!counts[only])
+                    ++only;
+                split = counts[only] != r.count;
+                if (split || (r.depth & 1))
+                    break;
+                ++r.depth;      // the same high byte, try the low one
+            }
+            if (!split) {
+                // all the same code unit: nothing to move, and likely more they have in common
+                r.depth = sharedPrefixDepth(r.keys, r.count, r.depth + 1);
+                continue;
+            }
+
+            qsizetype offset = 0;
+            for (uint b = 0; b < RadixBuckets; ++b) {
+                offsets[b] = offset;
+                offset += counts[b];
+            }
+            for (qsizetype i = 0; i < r.count; ++i)
+                r.scratch[offsets[radixBucket(r.units[i], r.depth)]++] = r.keys[i];
+            std::copy(r.scratch, r.scratch + r.count, r.keys);
+
+            // keys that ended are equal and in place; the other buckets are sorted one
+            // byte deeper
+            uint largest = 1;
+            for (uint b = 2; b < RadixBuckets; ++b) {
+                if (counts[b] > counts[largest])
+                    largest = b;
+            }
+            RadixRange next = r;
+            qsizetype begin = counts[0];
+            for (uint b = 1; b < RadixBuckets; ++b) {
+                const RadixRange bucket = { r.keys + begin, r.scratch + begin, r.units + begin, counts[b], r.depth + 1 };
+                if (b == largest)
+                    next = bucket;
+                else if (pool && bucket.count > RadixSpawnSize)
+                    pool->spawn([bucket, pool]() {
+                        radixSort(bucket.keys, bucket.scratch, bucket.units, bucket.count, bucket.depth, pool);
+                    });
+                else if (bucket.count > 1)
+                    pending.push_back(bucket);
+                begin += counts[b];
+            }
+            r = next;
+        }
+    }
+
+    // Sorts [keys, keys + count), whose first depth bytes are all the same, using
+    // scratch and units (of the same size) for the distribution passes. Large buckets
+    // are handed to pool if there is one. Every pass sets aside buckets of at most
+    // half its keys, so pending holds fewer than RadixBuckets times log2(count) of them.
+    inline void radixSort(SortKey *keys, SortKey *scratch, uint *units, qsizetype count, qsizetype depth,
+                          WorkStealingPool *pool)
+    {
+        std::vector<RadixRange> pending;
+        pending.reserve(RadixBuckets);
+        pending.push_back(RadixRange{ keys, scratch, units, count, depth });
+        while (!pending.empty()) {
+            const RadixRange r = pending.back();
+            pending.pop_back();
+            radixSortRange(r, pending, pool);
+        }
+    }
+
+    // Splits keys into buckets around splitters drawn from a sample, on all threads,
+    // and radix-sorts the buckets as tasks of a work-stealing pool. The sorted keys
+    // end up in scratch.
+    inline void sampleSort(SortKey *keys, SortKey *scratch, uint *units, qsizetype count, int threadCount)
+    {
+        const int bucketCount = qMin(8 * threadCount, 1024);
+        const int oversampling = 16;
+
+        // evenly spaced samples, so that already sorted input splits evenly too
+        std::vector<SortKey> splitters;
+        const qsizetype sampleCount = qsizetype(bucketCount) * oversampling;
+        splitters.reserve(size_t(sampleCount));
+        for (qsizetype i = 0; i < sampleCount; ++i)
+            splitters.push_back(keys[i * count / sampleCount]);
+        std::sort(splitters.begin(), splitters.end(), sortKeyLess);
+        for (int b = 1; b < bucketCount; ++b)
+            splitters[size_t(b - 1)] = splitters[size_t(b * oversampling)];
+        splitters.resize(size_t(bucketCount - 1));
+
+        // classify slice by slice: bucket of every key, then per-slice bucket counts
+        const int sliceCount = 4 * threadCount;
+        const qsizetype sliceSize = (count + sliceCount - 1) / sliceCount;
+        std::vector<ushort> bucketOf(static_cast<size_t>(count));
+        std::vector<qsizetype> counts(size_t(sliceCount) * size_t(bucketCount));
+        parallelFor(sliceCount, threadCount, 1, [&](qsizetype firstSlice, qsizetype lastSlice) {
+            for (qsizetype slice = firstSlice; slice < lastSlice; ++slice) {
+                qsizetype *sliceCounts = counts.data() + slice * bucketCount;
+                for (qsizetype i = slice * sliceSize; i < qMin(count, (slice + 1) * sliceSize); ++i) {
+                    const ushort b = ushort(std::upper_bound(splitters.begin(), splitters.end(), keys[i], sortKeyLess)
+                                            - splitters.begin());
+                    bucketOf[size_t(i)] = b;
+                    ++sliceCounts[b];
+                }
+            }
+        });
+
+        // bucket-major offsets, so every slice scatters into its own part of each bucket
+        std::vector<qsizetype> bucketBegin(size_t(bucketCount) + 1);
+        qsizetype offset = 0;
+        for (int b = 0; b < bucketCount; ++b) {
+            bucketBegin[size_t(b)] = offset;
+            for (int slice = 0; slice < sliceCount; ++slice) {
+                qsizetype &c = counts[size_t(slice) * size_t(bucketCount) + size_t(b)];
+                const qsizetype n = c;
+                c = offset;
+                offset += n;
+            }
+        }
+        bucketBegin[size_t(bucketCount)] = count;
+        parallelFor(sliceCount, threadCount, 1, [&](qsizetype firstSlice, qsizetype lastSlice) {
+            for (qsizetype slice = firstSlice; slice < lastSlice; ++slice) {
+                qsizetype *sliceOffsets = counts.data() + slice * bucketCount;
+                for (qsizetype i = slice * sliceSize; i < qMin(count, (slice + 1) * sliceSize); ++i)
+                    scratch[sliceOffsets[bucketOf[size_t(i)]]++] = keys[i];
+            }
+        });
+
+        WorkStealingPool pool(threadCount);
+        for (int b = 0; b < bucketCount; ++b) {
+            const qsizetype begin = bucketBegin[size_t(b)];
+            const qsizetype n = bucketBegin[size_t(b) + 1] - begin;
+            if (n > 1) {
+                SortKey *k = scratch + begin;
+                SortKey *s = keys + begin;
+                uint *u = units + begin;
+                WorkStealingPool *p = &pool;
+                pool.add([k, s, u, n, p]() { radixSort(k, s, u, n, 0, p); });
+            }
+        }
+        pool.run();
+    }
+
+    enum {
+        // below this many views a single thread sorts them, or drops duplicates
+        ParallelSortThreshold = 1 << 16,
+        // below this many views a single thread searches them
+        ParallelSearchThreshold = 1 << 16,
+        ParallelGrain = 1 << 13
+    };
+
+} // namespace QEmuPrivate
+
+namespace QEmuParallel {
+
+    inline void sort(QEmuStringView *first, QEmuStringView *last, int threadCount = 0)
+    {
+        using namespace QEmuPrivate;
+        const qsizetype count = last - first;
+        if (count < 2)
+            return;
+        threadCount = WorkStealingPool::idealThreadCount(threadCount);
+        if (count < ParallelSortThreshold)
+            threadCount = 1;
+
+        std::unique_ptr<SortKey[]> keys(new SortKey[size_t(count)]);
+        std::unique_ptr<SortKey[]> scratch(new SortKey[size_t(count)]);
+        std::unique_ptr<uint[]> units(new uint[size_t(count)]);
+        parallelFor(count, threadCount, ParallelGrain, [&](qsizetype begin, qsizetype end) {
+            for (qsizetype i = begin; i < end; ++i) {
+                SortKey &key = keys[size_t(i)];
+                key.data = reinterpret_cast<const ushort *>(first[i].constData());
+                key.size = first[i].size();
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+                key.index = i;
+#endif
+            }
+        });
+
+        SortKey *sorted = keys.get();
+        if (threadCount == 1) {
+            radixSort(keys.get(), scratch.get(), units.get(), count, 0, nullptr);
+        } else {
+            sampleSort(keys.get(), scratch.get(), units.get(), count, threadCount);
+            sorted = scratch.get();
+        }
+
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+        // a zero-copy view is its (pointer, length) pair, so rebuild the views in place
+        parallelFor(count, threadCount, ParallelGrain, [&](qsizetype begin, qsizetype end) {
+            for (qsizetype i = begin; i < end; ++i)
+                first[i] = QEmuStringView(reinterpret_cast<const QChar *>(sorted[i].data), sorted[i].size);
+        });
+#else
+        std::vector<QEmuStringView> ordered(static_cast<size_t>(count));
+        parallelFor(count, threadCount, ParallelGrain, [&](qsizetype begin, qsizetype end) {
+            for (qsizetype i = begin; i < end; ++i)
+                ordered[size_t(i)] = first[sorted[i].index];
+        });
+        parallelFor(count, threadCount, ParallelGrain, [&](qsizetype begin, qsizetype end) {
+            for (qsizetype i = begin; i < end; ++i)
+                first[i] = ordered[size_t(i)];
+        });
+#endif
+    }
+
+    // Drops all but the first of every run of equal views from the sorted range
+    // [first, last) and returns the new end, like std::unique().
+    inline QEmuStringView *unique(QEmuStringView *first, QEmuStringView *last, int threadCount = 0)
+    {
+        using namespace QEmuPrivate;
+        const qsizetype count = last - first;
+        threadCount = WorkStealingPool::idealThreadCount(threadCount);
+        if (count < ParallelSortThreshold || threadCount == 1)
+            return std::unique(first, last);
+
+        // count what every slice keeps, then copy that to its place in a second array
+        const int sliceCount = 4 * threadCount;
+        const qsizetype sliceSize = (count + sliceCount - 1) / sliceCount;
+        const auto kept = [first](qsizetype i) { return i == 0 || !(first[i] == first[i - 1]); };
+        std::vector<qsizetype> offsets(size_t(sliceCount) + 1);
+        parallelFor(sliceCount, threadCount, 1, [&](qsizetype firstSlice, qsizetype lastSlice) {
+            for (qsizetype slice = firstSlice; slice < lastSlice; ++slice) {
+                qsizetype n = 0;
+                for (qsizetype i = slice * sliceSize; i < qMin(count, (slice + 1) * sliceSize); ++i)
+                    n += kept(i);
+                offsets[size_t(slice) + 1] = n;
+            }
+        });
+        for (int slice = 0; slice < sliceCount; ++slice)
+            offsets[size_t(slice) + 1] += offsets[size_t(slice)];
+
+        const qsizetype total = offsets[size_t(sliceCount)];
+        std::vector<QEmuStringView> result(static_cast<size_t>(total));
+        parallelFor(sliceCount, threadCount, 1, [&](qsizetype firstSlice, qsizetype lastSlice) {
+            for (qsizetype slice = firstSlice; slice < lastSlice; ++slice) {
+                qsizetype out = offsets[size_t(slice)];
+                for (qsizetype i = slice * sliceSize; i < qMin(count, (slice + 1) * sliceSize); ++i) {
+                    if (kept(i))
+                        result[size_t(out++)] = first[i];
+                }
+            }
+        });
+        parallelFor(total, threadCount, ParallelGrain, [&](qsizetype begin, qsizetype end) {
+            for (qsizetype i = begin; i < end; ++i)
+                first[i] = result[size_t(i)];
+        });
+        return first + total;
+    }
+
+    // Indexes of the views in [first, last) that contain needle, in ascending order.
+    inline QVector<qsizetype> findAll(const QEmuStringView *first, const QEmuStringView *last, QEmuStringViewArg needle,
+                                      Qt::CaseSensitivity cs = Qt::CaseSensitive, int threadCount = 0)
+    {
+        using namespace QEmuPrivate;
+        const qsizetype count = last - first;
+        threadCount = WorkStealingPool::idealThreadCount(threadCount);
+        // every slice collects its own matches, which are then joined in order
+        const int sliceCount = count < ParallelSearchThreshold ? 1 : 4 * threadCount;
+        const qsizetype sliceSize = (count + sliceCount - 1) / sliceCount;
+        std::vector<QVector<qsizetype> > matches(static_cast<size_t>(sliceCount));
+        // the workers share the needle, so they only ever read its characters
+        const ushort *const n = reinterpret_cast<const ushort *>(needle.constData());
+        const qsizetype nlen = needle.size();
+        parallelFor(sliceCount, sliceCount == 1 ? 1 : threadCount, 1, [&](qsizetype firstSlice, qsizetype lastSlice) {
+            for (qsizetype slice = firstSlice; slice < lastSlice; ++slice) {
+                QVector<qsizetype> &found = matches[size_t(slice)];
+                for (qsizetype i = slice * sliceSize; i < qMin(count, (slice + 1) * sliceSize); ++i) {
+                    const QEmuStringView &hay = first[i];
+                    if (findString(reinterpret_cast<const ushort *>(hay.constData()), hay.size(), 0, n, nlen, cs) >= 0)
+                        found.append(i);
+                }
+            }
+        });
+
+        if (sliceCount == 1)
+            return matches.front();
+        int total = 0;
+        for (const QVector<qsizetype> &found : matches)
+            total += found.size();
+        QVector<qsizetype> result;
+        result.reserve(total);
+        for (const QVector<qsizetype> &found : matches)
+            result += found;
+        return result;
+    }
+
+    // the same for containers of views, such as QVector<QEmuStringView>
+    template <typename Container>
+    void sort(Container &views, int threadCount = 0)
+    {
+        sort(views.data(), views.data() + views.size(), threadCount);
+    }
+    template <typename Container>
+    void dedup(Container &views, int threadCount = 0)
+    {
+        sort(views, threadCount);
+        const qsizetype kept = unique(views.data(), views.data() + views.size(), threadCount) - views.data();
+        views.erase(views.begin() + kept, views.end());
+    }
+    template <typename Container>
+    QVector<qsizetype> findAll(const Container &views, QEmuStringViewArg needle,
+                               Qt::CaseSensitivity cs = Qt::CaseSensitive, int threadCount = 0)
+    {
+        return findAll(views.data(), views.data() + views.size(), needle, cs, threadCount);
+    }
+
+} // namespace QEmuParallel
+
+#endif // QEMUSTRINGVIEWALGORITHMS_H
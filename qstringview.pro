@@ -2,8 +2,14 @@ CONFIG += testcase
 TARGET = tst_qstringview
 ## uncomment to enable QStringView emulation:
 # DEFINES += QSTRINGVIEW_EMULATE
+## uncomment to make QEmuStringView a true (pointer, length) view instead of a QString:
+# DEFINES += QEMUSTRINGVIEW_ZEROCOPY
+## or, in the QString-based mode, to keep strings of up to 15 code units inside the view:
+# DEFINES += QEMUSTRINGVIEW_SSO
+## uncomment to count constructions, allocations and copied bytes (see QEmuStringViewStats):
+# DEFINES += QEMUSTRINGVIEW_INSTRUMENT
 QT = core testlib
 contains(QT_CONFIG, c++14):CONFIG *= c++14
 contains(QT_CONFIG, c++1z):CONFIG *= c++1z
 SOURCES += tst_qstringview.cpp
-HEADERS += qemustringview.h
+HEADERS += qemustringview.h qemustringviewalgorithms.h qemumappedstringview.h qemurecordreader.h allocationcounter.h
@@ -30,16 +30,38 @@
 
 #include <QChar>
 #include <QStringRef>
+#include <QVector>
+#include <QTemporaryFile>
+#include <QBuffer>
 
 #include <QTest>
 #include <QDebug>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
 
 #include "qemustringview.h"
+#include "qemustringviewalgorithms.h"
+#include "qemumappedstringview.h"
+#include "qemurecordreader.h"
+#include "allocationcounter.h"
 
 #ifdef QSTRINGVIEW_EMULATE
+#if !defined(QEMUSTRINGVIEW_ZEROCOPY) || defined(QEMUSTRINGVIEW_INSTRUMENT)
+// only the zero-copy views can be constant expressions, and not when they count themselves
+#define QEMUSTRINGVIEW_NO_CONSTEXPR
 #define constexpr /**/
+#endif
 #define TESTCLASS tst_QEmuStringView
 #else
 // no actual need to include the class header?!
@@ -132,7 +154,7 @@ const bool CanConvertFromWCharT =
 
 Q_STATIC_ASSERT(!CanConvert<wchar_t>::value);
 
-#ifndef QSTRINGVIEW_EMULATE
+#if !defined(QSTRINGVIEW_EMULATE) || defined(QEMUSTRINGVIEW_ZEROCOPY)
 Q_STATIC_ASSERT(CanConvert<      wchar_t*>::value == CanConvertFromWCharT);
 Q_STATIC_ASSERT(CanConvert<const wchar_t*>::value == CanConvertFromWCharT);
 
@@ -244,6 +266,31 @@ private Q_SLOTS:
 #endif
     }
 
+    // QEmuStringView extensions
+    void relationalOperators() const;
+    void qustrlen() const;
+    void slicing() const;
+    void searching() const;
+    void splitting() const;
+    void caseInsensitiveCompare() const;
+    void encoding() const;
+    void classification() const;
+    void decoding() const;
+    void wideStrings() const;
+    void smallStrings() const;
+    void layout() const;
+    void arena() const;
+    void interning() const;
+    void parallelAlgorithms() const;
+    void mappedFile() const;
+    void recordReader() const;
+    void stringBuilder() const;
+    void numbers() const;
+    void prettyUnicode() const;
+    void constexprKeywords() const;
+    void hashing() const;
+    void instrumentation() const;
+
 private:
     void debug(QStringRef arg) const;
     template <typename String>
@@ -258,7 +305,7 @@ private:
     void fromStdString() const { fromContainer<Char, std::basic_string<Char> >(); }
 };
 
-#ifdef QSTRINGVIEW_EMULATE
+#ifdef QEMUSTRINGVIEW_NO_CONSTEXPR
 #undef Q_STATIC_ASSERT
 #define Q_STATIC_ASSERT Q_ASSERT
 #endif
@@ -670,5 +717,1475 @@ void TESTCLASS::conversion_tests(String string) const
     }
 }
 
+void TESTCLASS::relationalOperators() const
+{
+#ifdef Q_STDLIB_UNICODE_STRINGS
+    // lengths on either side of the SSE2 and AVX2 block sizes
+    for (int len = 0; len < 70; ++len) {
+        const std::u16string a(len, u'x');
+        for (int pos = 0; pos < len; ++pos) {
+            std::u16string b = a;
+            b[pos] = u'y';
+            const QEmuStringView va(a), vb(b);
+            QVERIFY(va != vb);
+            QVERIFY(va < vb);
+            QVERIFY(vb > va);
+            QVERIFY(!(va == b));
+            QVERIFY(va < b);
+            QVERIFY(b > va);
+            QVERIFY(va < b.c_str());
+            QVERIFY(b.c_str() > va);
+        }
+        const QEmuStringView va(a);
+        QVERIFY(va == a);
+        QVERIFY(a == va);
+        QVERIFY(va == a.c_str());
+        QVERIFY(va <= a.c_str());
+        QVERIFY(va >= a);
+        if (len) {
+            QVERIFY(QEmuStringView(a.data(), len - 1) < a);
+            QVERIFY(a.c_str() > QEmuStringView(a.data(), len - 1));
+        }
+    }
+#endif
+
+    const QEmuStringView x(u"x");
+    QVERIFY(x == u'x');
+    QVERIFY(u'x' == x);
+    QVERIFY(x == QChar(QLatin1Char('x')));
+    QVERIFY(x != u'y');
+    QVERIFY(x < u'y');
+    QVERIFY(u'w' < x);
+    QVERIFY(QEmuStringView() < u'a');
+    // code units compare as unsigned
+    QVERIFY(QEmuStringView(u"\xffff") > u'a');
+}
+
+void TESTCLASS::qustrlen() const
+{
+    typedef qsizetype (*Impl)(const ushort *);
+    QVector<Impl> impls;
+    impls.append(QEmuPrivate::qustrlen);
+    impls.append(QEmuPrivate::qustrlen_generic);
+#ifdef __SSE2__
+    impls.append(QEmuPrivate::qustrlen_sse2);
+#endif
+#ifdef QEMUSTRINGVIEW_CPU_DISPATCH
+    if (QEmuPrivate::cpuHasAvx2())
+        impls.append(QEmuPrivate::qustrlen_avx2);
+    if (QEmuPrivate::cpuHasAvx512bw())
+        impls.append(QEmuPrivate::qustrlen_avx512);
+#endif
+
+    // every start offset within a 64-byte block, and terminators on either
+    // side of each block boundary
+    alignas(64) ushort buffer[256];
+    for (int start = 0; start < 32; ++start) {
+        for (int len = 0; len < 160; ++len) {
+            std::fill(std::begin(buffer), std::end(buffer), ushort('x'));
+            buffer[start + len] = 0;
+            for (Impl impl : impls)
+                QCOMPARE(impl(buffer + start), qsizetype(len));
+        }
+    }
+}
+
+void TESTCLASS::slicing() const
+{
+    const char16_t text[] = u"  Hello, World!\t";
+    const QEmuStringView v(text);
+    const QChar *d = v.constData();
+    const QString ref = v.toString();
+
+    for (int pos = -3; pos <= v.size() + 2; ++pos) {
+        for (int n = -2; n <= v.size() + 2; ++n) {
+            const QEmuStringView m = v.mid(pos, n);
+            QCOMPARE(m.toString(), ref.mid(pos, n));
+            if (!m.isEmpty())
+                QVERIFY(m.constData() >= d && m.constData() + m.size() <= d + v.size());
+        }
+        QCOMPARE(v.mid(pos).toString(), ref.mid(pos));
+        QCOMPARE(v.left(pos).toString(), ref.left(pos));
+        QCOMPARE(v.right(pos).toString(), ref.right(pos));
+    }
+    QVERIFY(v.mid(int(v.size()) + 1).isNull());
+    QVERIFY(!v.mid(int(v.size())).isNull());
+
+    // no copies: the slices point into the original data
+    QCOMPARE(v.mid(2, 5).constData(), d + 2);
+    QCOMPARE(v.right(3).constData(), d + v.size() - 3);
+    QCOMPARE(v.chopped(1).constData(), d);
+    QCOMPARE(v.chopped(1).size(), v.size() - 1);
+    QCOMPARE(v.trimmed().toString(), QString::fromLatin1("Hello, World!"));
+    QCOMPARE(v.trimmed().constData(), d + 2);
+    QCOMPARE(QEmuStringView(u" \t ").trimmed().size(), qsizetype(0));
+    QVERIFY(QEmuStringView().trimmed().isNull());
+
+    QEmuStringView t = v;
+    t.chop(3);
+    QCOMPARE(t.toString(), ref.left(int(v.size()) - 3));
+    QCOMPARE(t.constData(), d);
+    t.truncate(4);
+    QCOMPARE(t.toString(), QString::fromLatin1("  He"));
+    t.truncate(10);
+    QCOMPARE(t.size(), qsizetype(4));
+    t.chop(10);
+    QVERIFY(t.isEmpty());
+}
+
+static bool refMatch(const std::u16string &h, qsizetype i, const std::u16string &n, Qt::CaseSensitivity cs)
+{
+    for (size_t k = 0; k < n.size(); ++k) {
+        uint a = h[i + k], b = n[k];
+        if (cs == Qt::CaseInsensitive) {
+            a = QChar::toCaseFolded(a);
+            b = QChar::toCaseFolded(b);
+        }
+        if (a != b)
+            return false;
+    }
+    return true;
+}
+
+void TESTCLASS::searching() const
+{
+    // long enough to cross every SIMD block size, with characters that only
+    // match case-insensitively, some of them outside ASCII
+    static const char16_t alphabet[] = u"abkAK\u212a\u00e9\u00c9:";
+    std::u16string hay;
+    for (int i = 0; i < 70; ++i)
+        hay += alphabet[(i * 7 + i / 5) % 9];
+
+    for (qsizetype len = 0; len <= qsizetype(hay.size()); len += 3) {
+        const std::u16string h = hay.substr(0, len);
+        const QEmuStringView v(h.data(), len);
+        std::vector<std::u16string> needles = { u"", u"a", u"k", u"\u00e9", u"ab", u"xyz", u"aKa" };
+        for (qsizetype pos = 0; pos + 4 <= len; pos += 5)
+            needles.push_back(h.substr(pos, 1 + pos % 4));
+
+        for (const std::u16string &n : needles) {
+            const QEmuStringView vn(n.data(), qsizetype(n.size()));
+            for (Qt::CaseSensitivity cs : { Qt::CaseSensitive, Qt::CaseInsensitive }) {
+                for (qsizetype from = -len - 2; from <= len + 2; ++from) {
+                    qsizetype expected = -1;
+                    for (qsizetype i = from < 0 ? qMax(from + len, qsizetype(0)) : from; i + qsizetype(n.size()) <= len; ++i) {
+                        if (refMatch(h, i, n, cs)) {
+                            expected = i;
+                            break;
+                        }
+                    }
+                    QCOMPARE(v.indexOf(vn, from, cs), expected);
+                    if (n.size() == 1)
+                        QCOMPARE(v.indexOf(QChar(n[0]), from, cs), expected);
+                }
+                if (n.empty())
+                    continue;
+
+                qsizetype occurrences = 0;
+                for (qsizetype i = 0; i + qsizetype(n.size()) <= len; ++i)
+                    occurrences += refMatch(h, i, n, cs);
+                QCOMPARE(v.count(vn, cs), occurrences);
+                QCOMPARE(v.contains(vn, cs), occurrences != 0);
+                if (n.size() == 1)
+                    QCOMPARE(v.count(QChar(n[0]), cs), occurrences);
+
+                for (qsizetype from = -1; from < len; ++from) {
+                    const qsizetype start = qMin(from < 0 ? len - 1 : from, len - qsizetype(n.size()));
+                    qsizetype expected = -1;
+                    for (qsizetype i = start; i >= 0; --i) {
+                        if (refMatch(h, i, n, cs)) {
+                            expected = i;
+                            break;
+                        }
+                    }
+                    QCOMPARE(v.lastIndexOf(vn, from, cs), expected);
+                    if (n.size() == 1)
+                        QCOMPARE(v.lastIndexOf(QChar(n[0]), from, cs), expected);
+                }
+
+                const bool fits = n.size() <= size_t(len);
+                QCOMPARE(v.startsWith(vn, cs), fits && refMatch(h, 0, n, cs));
+                QCOMPARE(v.endsWith(vn, cs), fits && refMatch(h, len - n.size(), n, cs));
+            }
+        }
+    }
+
+    // QString's conventions for empty needles and null views
+    const QEmuStringView abc(u"abc");
+    QCOMPARE(abc.indexOf(QEmuStringView(u""), 3), qsizetype(3));
+    QCOMPARE(abc.indexOf(QEmuStringView(u""), 4), qsizetype(-1));
+    QCOMPARE(abc.lastIndexOf(QEmuStringView(u""), 3), qsizetype(3));
+    QCOMPARE(abc.count(QEmuStringView(u"")), qsizetype(4));
+    QCOMPARE(QEmuStringView(u"aaaa").count(QEmuStringView(u"aa")), qsizetype(3));
+    QVERIFY(abc.startsWith(QEmuStringView(u"")));
+    QVERIFY(!QEmuStringView().startsWith(QEmuStringView(u"")));
+    QVERIFY(QEmuStringView().startsWith(QEmuStringView()));
+    QVERIFY(abc.startsWith(QChar(u'a')));
+    QVERIFY(abc.endsWith(QChar(u'C'), Qt::CaseInsensitive));
+    QVERIFY(!abc.endsWith(QChar(u'C')));
+
+    // surrogate pairs fold as a whole
+    const QEmuStringView deseret(u"x\U00010400y");
+    QCOMPARE(deseret.indexOf(QEmuStringView(u"\U00010428y"), 0, Qt::CaseInsensitive), qsizetype(1));
+    QCOMPARE(deseret.indexOf(QEmuStringView(u"\U00010428y")), qsizetype(-1));
+
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    // a slice is a QString::fromRawData(): searching it must read its characters where
+    // they are, without QString::utf16() copying them to NUL-terminate them
+    const QString text = QStringLiteral("the quick brown fox jumps over the lazy dog");
+    QEmuStringView slice = QEmuStringView(text).mid(4, 30);
+    const QString::DataPtr before = slice.data_ptr();
+    QCOMPARE(slice.indexOf(QEmuStringView(u"fox")), qsizetype(12));
+    QCOMPARE(slice.lastIndexOf(QChar(u'o')), qsizetype(22));
+    QCOMPARE(slice.count(QChar(u'o')), qsizetype(3));
+    QVERIFY(slice.contains(QEmuStringView(u"JUMPS"), Qt::CaseInsensitive));
+    QVERIFY(slice.startsWith(QEmuStringView(u"quick")));
+    QVERIFY(slice.endsWith(QEmuStringView(u"the")));
+    QVERIFY(slice.compare(QEmuStringView(u"QUICK"), Qt::CaseInsensitive) > 0);
+    QVERIFY(slice == QEmuStringView(u"quick brown fox jumps over the"));
+    QCOMPARE(slice.data_ptr(), before);
+    QCOMPARE(slice.constData(), text.constData() + 4);
+#endif
+}
+
+static std::u16string refFold(const std::u16string &s)
+{
+    std::u16string result;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (QChar::isHighSurrogate(s[i]) && i + 1 < s.size() && QChar::isLowSurrogate(s[i + 1])) {
+            const uint folded = QChar::toCaseFolded(QChar::surrogateToUcs4(s[i], s[i + 1]));
+            result += char16_t(QChar::highSurrogate(folded));
+            result += char16_t(QChar::lowSurrogate(folded));
+            ++i;
+        } else {
+            result += char16_t(QChar::toCaseFolded(uint(s[i])));
+        }
+    }
+    return result;
+}
+
+static int sign(int n)
+{
+    return n < 0 ? -1 : n > 0 ? 1 : 0;
+}
+
+static std::vector<std::u16string> fields(const QEmuStringTokenizer &tokenizer)
+{
+    std::vector<std::u16string> result;
+    for (QEmuStringView field : tokenizer)
+        result.push_back(std::u16string(reinterpret_cast<const char16_t *>(field.utf16()), size_t(field.size())));
+    return result;
+}
+
+void TESTCLASS::splitting() const
+{
+    typedef std::vector<std::u16string> Fields;
+    const char16_t csv[] = u"id,,name,Name,";
+    const QEmuStringView line(csv);
+
+    // the same fields as QString::split()
+    QCOMPARE(fields(line.split(QChar(','))), (Fields{ u"id", u"", u"name", u"Name", u"" }));
+    QCOMPARE(fields(line.split(QChar(','), QString::SkipEmptyParts)), (Fields{ u"id", u"name", u"Name" }));
+    QCOMPARE(fields(line.split(QEmuStringView(u",N"))), (Fields{ u"id,,name", u"ame," }));
+    QCOMPARE(fields(line.split(QEmuStringView(u"n"), QString::KeepEmptyParts, Qt::CaseInsensitive)),
+             (Fields{ u"id,,", u"ame,", u"ame," }));
+    QCOMPARE(fields(line.split(QChar('N'), QString::KeepEmptyParts, Qt::CaseInsensitive)),
+             (Fields{ u"id,,", u"ame,", u"ame," }));
+    QCOMPARE(fields(line.split(QChar(';'))), (Fields{ u"id,,name,Name," }));
+    QCOMPARE(fields(QEmuStringView(u"abc").split(QEmuStringView(u""))), (Fields{ u"", u"a", u"b", u"c", u"" }));
+    QCOMPARE(fields(QEmuStringView(u"abc").split(QEmuStringView(u""), QString::SkipEmptyParts)), (Fields{ u"a", u"b", u"c" }));
+    QCOMPARE(fields(QEmuStringView(u"").split(QChar(','))), (Fields{ u"" }));
+    QCOMPARE(fields(QEmuStringView(u"").split(QChar(','), QString::SkipEmptyParts)), Fields());
+    QCOMPARE(fields(QEmuStringView(u",,").split(QEmuStringView(u","))), (Fields{ u"", u"", u"" }));
+
+    // long fields go through the SIMD scan, and the fields point into the line
+    std::u16string tsv;
+    for (int i = 0; i < 40; ++i)
+        tsv += std::u16string(size_t(i), char16_t('a' + i % 26)) + u'\t';
+    const QEmuStringView record(tsv.data(), qsizetype(tsv.size()));
+    qsizetype n = 0;
+    for (QEmuStringView field : record.split(QChar('\t'))) {
+        if (n < 40) {
+            QCOMPARE(field.size(), n);
+            QCOMPARE(field.count(QChar(ushort('a' + n % 26))), n);
+        } else {
+            QVERIFY(field.isEmpty());
+        }
+        if (!field.isEmpty())
+            QVERIFY(field.constData() > record.constData() && field.constData() < record.constData() + record.size());
+        ++n;
+    }
+    QCOMPARE(n, qsizetype(41));
+
+    const QEmuStringTokenizer tokens = line.tokenize(QChar(','), QString::SkipEmptyParts);
+    QEmuStringTokenizer::const_iterator it = tokens.begin();
+    QVERIFY(it != tokens.end());
+    QCOMPARE(it->size(), qsizetype(2));
+    QEmuStringTokenizer::const_iterator copy = it++;
+    QVERIFY(copy != it);
+    QVERIFY(++copy == it);
+    QCOMPARE(*it, QEmuStringView(u"name"));
+    QCOMPARE(std::distance(tokens.begin(), tokens.end()), std::ptrdiff_t(3));
+
+    const QVector<QEmuStringView> views = tokens.toContainer();
+    QCOMPARE(views.size(), 3);
+    QCOMPARE(views.at(2), QEmuStringView(u"Name"));
+    const QStringList list = tokens.toStringList();
+    QCOMPARE(list.size(), 3);
+    QCOMPARE(list.at(0), QStringLiteral("id"));
+}
+
+void TESTCLASS::caseInsensitiveCompare() const
+{
+    // ASCII blocks, blocks that are not, and blocks that only one side makes non-ASCII
+    static const char16_t *const pieces[] = {
+        u"a", u"B", u"z", u"[", u"@", u"k", u"K", u"\u212a", u"\u00e9", u"\u00c9", u"\U00010400", u"\U00010428"
+    };
+    const int pieceCount = int(sizeof(pieces) / sizeof(pieces[0]));
+    uint seed = 1;
+    auto next = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7fff; };
+
+    for (int round = 0; round < 3000; ++round) {
+        std::u16string a;
+        const int len = int(next() % 40);
+        for (int i = 0; i < len; ++i)
+            a += pieces[next() % pieceCount];
+        // mostly equal up to case, then change or cut something
+        std::u16string b = next() % 2 ? refFold(a) : a;
+        if (!b.empty() && next() % 3 == 0)
+            b[next() % b.size()] = char16_t(u'a' + next() % 26);
+        if (!b.empty() && next() % 4 == 0)
+            b.resize(next() % b.size());
+
+        const QEmuStringView va(a.data(), qsizetype(a.size()));
+        const QEmuStringView vb(b.data(), qsizetype(b.size()));
+        const std::u16string fa = refFold(a);
+        const std::u16string fb = refFold(b);
+        const int expected = fa < fb ? -1 : fa == fb ? 0 : 1;
+        QCOMPARE(sign(va.compare(vb, Qt::CaseInsensitive)), expected);
+        QCOMPARE(sign(vb.compare(va, Qt::CaseInsensitive)), -expected);
+        QCOMPARE(va.equalsIgnoreCase(vb), expected == 0);
+        QCOMPARE(sign(va.compare(vb)), a < b ? -1 : a == b ? 0 : 1);
+    }
+
+    QCOMPARE(QEmuStringView(u"ABC").compare(QEmuStringView(u"abd"), Qt::CaseInsensitive), int(u'c') - int(u'd'));
+    QVERIFY(QEmuStringView(u"K").equalsIgnoreCase(QEmuStringView(u"\u212a")));
+    QVERIFY(QEmuStringView().equalsIgnoreCase(QEmuStringView(u"")));
+}
+
+void TESTCLASS::encoding() const
+{
+    // long ASCII runs for the SIMD paths, broken up by everything that is not
+    static const char16_t *const pieces[] = {
+        u"abcdefghijklmnopqrstuvwxyz0123456789", u"x", u"\u00e9", u"\u00ff", u"\u0100", u"\u20ac",
+        u"\U0001F600", u"\xd800", u"\xdc00"
+    };
+    const int pieceCount = int(sizeof(pieces) / sizeof(pieces[0]));
+    uint seed = 7;
+    auto next = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7fff; };
+
+    QByteArray reserved;
+    reserved.reserve(4096);
+    for (int round = 0; round < 500; ++round) {
+        std::u16string str;
+        const int pieceTotal = int(next() % 12);
+        for (int i = 0; i < pieceTotal; ++i)
+            str += pieces[next() % 3 ? 0 : next() % pieceCount];
+        if (!str.empty())
+            str.resize(next() % (str.size() + 1));
+
+        const QEmuStringView v(str.data(), qsizetype(str.size()));
+        const QString ref = QString(reinterpret_cast<const QChar *>(str.data()), int(str.size()));
+        QCOMPARE(v.toUtf8(), ref.toUtf8());
+        QCOMPARE(v.toLatin1(), ref.toLatin1());
+        QCOMPARE(v.toLocal8Bit(), ref.toLocal8Bit());
+
+        std::vector<char> buffer(size_t(v.maxUtf8Size()) + 1, 'Z');
+        const qsizetype written = v.toUtf8(buffer.data());
+        QCOMPARE(QByteArray(buffer.data(), int(written)), ref.toUtf8());
+        QVERIFY(written <= v.maxUtf8Size());
+        QCOMPARE(buffer.back(), 'Z');
+
+        // no reallocation once the capacity is there
+        const char *before = reserved.constData();
+        v.toUtf8(reserved);
+        QCOMPARE(reserved, ref.toUtf8());
+        v.toLatin1(reserved);
+        QCOMPARE(reserved, ref.toLatin1());
+        QCOMPARE(reserved.constData(), before);
+    }
+
+    QVERIFY(QEmuStringView().toUtf8().isNull());
+    QVERIFY(QEmuStringView().toLatin1().isNull());
+}
+
+void TESTCLASS::classification() const
+{
+    // runs long enough for every SIMD block size, broken up by pairs and lone halves
+    static const char16_t *const pieces[] = {
+        u"abcdefghijklmnopqrstuvwxyz0123456789", u"x", u"é", u"ÿ", u"Ā", u"€",
+        u"\U0001F600", u"\U0010FFFF", u"\xd800", u"\xdbff", u"\xdc00", u"\xdfff"
+    };
+    const int pieceCount = int(sizeof(pieces) / sizeof(pieces[0]));
+    uint seed = 11;
+    auto next = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7fff; };
+
+    for (int round = 0; round < 1000; ++round) {
+        std::u16string str;
+        const int pieceTotal = int(next() % 12);
+        for (int i = 0; i < pieceTotal; ++i)
+            str += pieces[next() % 3 ? 0 : next() % pieceCount];
+        // every alignment, and cuts through the middle of a pair
+        const qsizetype from = str.empty() ? 0 : next() % str.size();
+        const QEmuStringView v = QEmuStringView(str.data(), qsizetype(str.size())).mid(from);
+
+        bool ascii = true, latin1 = true;
+        std::vector<char32_t> expected;
+        std::vector<qsizetype> positions;
+        for (qsizetype i = 0; i < v.size(); ++i) {
+            const ushort u = v.at(i).unicode();
+            ascii = ascii && u < 0x80;
+            latin1 = latin1 && u < 0x100;
+            positions.push_back(i);
+            if (QChar::isHighSurrogate(u) && i + 1 < v.size() && QChar::isLowSurrogate(v.at(i + 1).unicode())) {
+                expected.push_back(QChar::surrogateToUcs4(u, v.at(++i).unicode()));
+            } else {
+                expected.push_back(QChar::isSurrogate(u) ? char32_t(0xfffd) : char32_t(u));
+            }
+        }
+        const bool valid = std::find(expected.begin(), expected.end(), char32_t(0xfffd)) == expected.end();
+        QCOMPARE(v.isAscii(), ascii);
+        QCOMPARE(v.isLatin1(), latin1);
+        QCOMPARE(v.isValidUtf16(), valid);
+
+        std::vector<char32_t> forward, backward;
+        const QEmuStringCodePoints codePoints = v.codePoints();
+        for (QEmuStringCodePoints::const_iterator it = codePoints.begin(); it != codePoints.end(); ++it) {
+            QCOMPARE(it.position(), positions[forward.size()]);
+            forward.push_back(*it);
+        }
+        for (QEmuStringCodePoints::const_iterator it = codePoints.end(); it != codePoints.begin(); )
+            backward.push_back(*--it);
+        QVERIFY(forward == expected);
+        QVERIFY(std::equal(backward.rbegin(), backward.rend(), expected.begin(), expected.end()));
+    }
+
+    QVERIFY(QEmuStringView().isAscii());
+    QVERIFY(QEmuStringView().isValidUtf16());
+    QVERIFY(QEmuStringView().codePoints().begin() == QEmuStringView().codePoints().end());
+    // a pair split across two of the kernels' blocks is still a pair
+    const std::u16string split = std::u16string(15, u'a') + u"\U0001F600" + std::u16string(15, u'a');
+    QVERIFY(QEmuStringView(split.data(), qsizetype(split.size())).isValidUtf16());
+    QVERIFY(!QEmuStringView(split.data(), 16).isValidUtf16());
+    QVERIFY(!QEmuStringView(split.data() + 16, 15).isValidUtf16());
+    QVERIFY(QEmuStringView(u"ÿ").isLatin1());
+    QVERIFY(!QEmuStringView(u"ÿ").isAscii());
+}
+
+void TESTCLASS::decoding() const
+{
+    QEmuUtf16Buffer buffer;
+    bool ok = false;
+
+    // round trips, with ASCII runs long enough for the SIMD paths
+    static const char16_t *const pieces[] = {
+        u"abcdefghijklmnopqrstuvwxyz0123456789", u"x", u"é", u"߿", u"ࠀ", u"€",
+        u"￿", u"\U0001F600", u"\U0010FFFF"
+    };
+    const int pieceCount = int(sizeof(pieces) / sizeof(pieces[0]));
+    uint seed = 11;
+    auto next = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7fff; };
+    for (int round = 0; round < 500; ++round) {
+        std::u16string str;
+        const int pieceTotal = int(next() % 12);
+        for (int i = 0; i < pieceTotal; ++i)
+            str += pieces[next() % 3 ? 0 : next() % pieceCount];
+        const QString ref = QString(reinterpret_cast<const QChar *>(str.data()), int(str.size()));
+        const QByteArray utf8 = ref.toUtf8();
+
+        const QEmuStringView v = buffer.fromUtf8(utf8.constData(), utf8.size(), &ok);
+        QVERIFY(ok);
+        QCOMPARE(v.toString(), ref);
+        QCOMPARE(v.toString(), QString::fromUtf8(utf8));
+    }
+
+    // one U+FFFD per byte that does not start a valid sequence
+    const QString fffd(QChar(QChar::ReplacementCharacter));
+    const struct { const char *utf8; QString expected; } invalid[] = {
+        { "a\x80z", "a" + fffd + "z" },
+        { "\xc0\xaf", fffd + fffd },                    // overlong '/'
+        { "\xe0\x80\xaf", fffd + fffd + fffd },          // overlong '/'
+        { "\xed\xa0\x80", fffd + fffd + fffd },          // surrogate
+        { "\xf4\x90\x80\x80", fffd + fffd + fffd + fffd }, // above U+10FFFF
+        { "\xf8\x88\x80\x80\x80", fffd + fffd + fffd + fffd + fffd },
+        { "\xe2\x82z", fffd + fffd + "z" },              // missing continuation
+        { "abc\xe2\x82", "abc" + fffd + fffd },          // truncated at the end
+        { "0123456789abcdef0123456789abcdef\xff", "0123456789abcdef0123456789abcdef" + fffd },
+    };
+    for (const auto &t : invalid) {
+        const QEmuStringView v = buffer.fromUtf8(t.utf8, qsizetype(strlen(t.utf8)), &ok);
+        QVERIFY(!ok);
+        QCOMPARE(v.toString(), t.expected);
+    }
+
+    // a leading BOM is dropped, like QString::fromUtf8() does
+    QCOMPARE(buffer.fromUtf8("\xef\xbb\xbf" "abc", 6).toString(), QStringLiteral("abc"));
+    QCOMPARE(buffer.fromUtf8("a\xef\xbb\xbf", 4).toString(), QString(QLatin1Char('a')) + QChar(0xfeff));
+
+    QByteArray latin1;
+    for (int round = 0; round < 3; ++round) {
+        for (int c = 0; c < 256; ++c)
+            latin1 += char(c);
+    }
+    QCOMPARE(buffer.fromLatin1(latin1).toString(), QString::fromLatin1(latin1));
+
+    // null stays null, empty stays empty
+    QVERIFY(buffer.fromUtf8(QByteArray()).isNull());
+    QVERIFY(buffer.fromLatin1(QByteArray()).isNull());
+    QVERIFY(!buffer.fromUtf8("", 0).isNull());
+    QVERIFY(buffer.fromUtf8("", 0).isEmpty());
+
+    // the storage is reused instead of reallocated
+    const QEmuStringView first = buffer.fromLatin1(latin1);
+    const QEmuStringView second = buffer.fromUtf8("field", 5);
+    QCOMPARE(second.data(), first.data());
+    QCOMPARE(second.toString(), QStringLiteral("field"));
+    QVERIFY(buffer.capacity() >= latin1.size());
+
+    QEmuUtf16Buffer &perThread = QEmuUtf16Buffer::forThread();
+    QCOMPARE(&perThread, &QEmuUtf16Buffer::forThread());
+    QCOMPARE(perThread.fromUtf8("\xc3\xa9t\xc3\xa9", 5).toString(), QString::fromUtf8("\xc3\xa9t\xc3\xa9"));
+}
+
+void TESTCLASS::numbers() const
+{
+    bool ok = false;
+#define VIEW(str) QEmuStringView(u"" str)
+    QCOMPARE(VIEW("42").toInt(&ok), 42);
+    QVERIFY(ok);
+    QCOMPARE(VIEW(" \t-17 \n").toInt(&ok), -17);
+    QVERIFY(ok);
+    QCOMPARE(VIEW("+0").toUInt(&ok), 0u);
+    QVERIFY(ok);
+    QCOMPARE(VIEW("-0").toUInt(&ok), 0u);
+    QVERIFY(!ok);
+    for (const char16_t *bad : { u"", u" ", u"-", u"1 2", u"1,000", u"12a", u"0x", u"١" }) {
+        QCOMPARE(QEmuStringView(bad).toLongLong(&ok), 0);
+        QVERIFY(!ok);
+    }
+    // the limits of each type, on both sides
+    QCOMPARE(VIEW("2147483647").toInt(&ok), 2147483647);
+    QVERIFY(ok);
+    QCOMPARE(VIEW("-2147483648").toInt(&ok), int(-2147483647 - 1));
+    QVERIFY(ok);
+    QCOMPARE(VIEW("2147483648").toInt(&ok), 0);
+    QVERIFY(!ok);
+    QCOMPARE(VIEW("4294967295").toUInt(&ok), 4294967295u);
+    QVERIFY(ok);
+    QCOMPARE(VIEW("-32768").toShort(&ok), short(-32768));
+    QVERIFY(ok);
+    QCOMPARE(VIEW("65536").toUShort(&ok), ushort(0));
+    QVERIFY(!ok);
+    QCOMPARE(VIEW("9223372036854775807").toLongLong(&ok), Q_INT64_C(9223372036854775807));
+    QVERIFY(ok);
+    QCOMPARE(VIEW("-9223372036854775808").toLongLong(&ok), -Q_INT64_C(9223372036854775807) - 1);
+    QVERIFY(ok);
+    QCOMPARE(VIEW("9223372036854775808").toLongLong(&ok), Q_INT64_C(0));
+    QVERIFY(!ok);
+    QCOMPARE(VIEW("18446744073709551615").toULongLong(&ok), Q_UINT64_C(18446744073709551615));
+    QVERIFY(ok);
+    QCOMPARE(VIEW("18446744073709551616").toULongLong(&ok), Q_UINT64_C(0));
+    QVERIFY(!ok);
+    QCOMPARE(VIEW("000000000000000000000000000012345678901234567").toULongLong(&ok), Q_UINT64_C(12345678901234567));
+    QVERIFY(ok);
+    // other bases
+    QCOMPARE(VIEW("ff").toInt(&ok, 16), 255);
+    QCOMPARE(VIEW("0xFF").toInt(&ok, 16), 255);
+    QCOMPARE(VIEW("0x1f").toInt(&ok, 0), 31);
+    QCOMPARE(VIEW("017").toInt(&ok, 0), 15);
+    QCOMPARE(VIEW("17").toInt(&ok, 0), 17);
+    QCOMPARE(VIEW("-101").toInt(&ok, 2), -5);
+    QCOMPARE(VIEW("zz").toInt(&ok, 36), 35 * 36 + 35);
+    QVERIFY(ok);
+    QCOMPARE(VIEW("12").toInt(&ok, 2), 0);
+    QVERIFY(!ok);
+    QCOMPARE(VIEW("12").toInt(&ok, 37), 0);
+    QVERIFY(!ok);
+
+    // every length around the 8-digit blocks
+    qulonglong expected = 0;
+    std::u16string digits;
+    for (int i = 1; i <= 19; ++i) {
+        digits += char16_t('0' + i % 10);
+        expected = expected * 10 + i % 10;
+        QCOMPARE(QEmuStringView(digits.data(), qsizetype(digits.size())).toULongLong(&ok), expected);
+        QVERIFY(ok);
+        digits.back() = u'x';
+        QCOMPARE(QEmuStringView(digits.data(), qsizetype(digits.size())).toULongLong(&ok), Q_UINT64_C(0));
+        QVERIFY(!ok);
+        digits.back() = char16_t('0' + i % 10);
+    }
+
+    // doubles, correctly rounded whichever way they are computed
+    for (const char *text : { "0", "-0", "1", "-1.5", "0.1", ".5", "5.", "3.141592653589793", "1e22", "1e23",
+                              "9007199254740993", "123456789012345678901234567890", "2.2250738585072011e-308",
+                              "4.9e-324", "-1e-310", "1.7976931348623157e308", "0.000000000000000000000000000001",
+                              "1.00000000000000011102230246251565404236316680908203125", "7.2057594037927933e16",
+                              "  -6.02214076E+23\t" }) {
+        const QString str = QString::fromLatin1(text);
+        const double d = QEmuStringView(str).toDouble(&ok);
+        QVERIFY2(ok, text);
+        QCOMPARE(d, std::strtod(text, nullptr));
+        QCOMPARE(std::signbit(d), std::signbit(std::strtod(text, nullptr)));
+    }
+    for (const char16_t *bad : { u"", u".", u"e5", u"1e", u"1e+", u"1.2.3", u"0x10", u"1,5", u"- 1", u"infinity" }) {
+        QCOMPARE(QEmuStringView(bad).toDouble(&ok), 0.0);
+        QVERIFY(!ok);
+    }
+    QVERIFY(std::isinf(VIEW("-INF").toDouble(&ok)) && ok);
+    QVERIFY(std::isnan(VIEW("nan").toDouble(&ok)) && ok);
+    QCOMPARE(VIEW("1e400").toDouble(&ok), std::numeric_limits<double>::infinity());
+    QVERIFY(!ok);
+    QCOMPARE(VIEW("1e-400").toDouble(&ok), 0.0);
+    QVERIFY(!ok);
+
+    QCOMPARE(VIEW("0.1").toFloat(&ok), 0.1f);
+    QVERIFY(ok);
+    QCOMPARE(VIEW("1e39").toFloat(&ok), std::numeric_limits<float>::infinity());
+    QVERIFY(!ok);
+    QCOMPARE(VIEW("1e-50").toFloat(&ok), 0.0f);
+    QVERIFY(!ok);
+#undef VIEW
+}
+
+void TESTCLASS::prettyUnicode() const
+{
+    const QEmuStringView mixed(u"say \"héllo\"\\\n\ttab");
+    const QByteArray expected("\"say \\\"h\\u00E9llo\\\"\\\\\\n\\ttab\"");
+    QScopedArrayPointer<char> allocated(mixed.toPrettyUnicode());
+    QCOMPARE(QByteArray(allocated.data()), expected);
+    char buffer[256];
+    QCOMPARE(mixed.toPrettyUnicode(buffer, sizeof(buffer)), qsizetype(expected.size()));
+    QCOMPARE(QByteArray(buffer), expected);
+    QByteArray out;
+    mixed.toPrettyUnicode(out);
+    QCOMPARE(out, expected);
+    QEmuStringView().toPrettyUnicode(out);
+    QCOMPARE(out, QByteArray("\"\""));
+
+    // long runs of plain text are cut where QTest cuts them, escapes are never split
+    const std::u16string longText = std::u16string(300, u'x');
+    allocated.reset(QEmuStringView(longText).toPrettyUnicode());
+    QCOMPARE(QByteArray(allocated.data()), '"' + QByteArray(245, 'x') + "\"...");
+    const std::u16string escapes = std::u16string(244, u'x') + u"éé";
+    allocated.reset(QEmuStringView(escapes).toPrettyUnicode());
+    QCOMPARE(QByteArray(allocated.data()), '"' + QByteArray(244, 'x') + "\\u00E9\"...");
+    const QByteArray cut = '"' + QByteArray(20, 'x') + "\"...";
+    QCOMPARE(QEmuStringView(longText).toPrettyUnicode(buffer, 31), qsizetype(cut.size()));
+    QCOMPARE(QByteArray(buffer), cut);
+    QEmuStringView(longText).toPrettyUnicode(out, 20);
+    QCOMPARE(out, cut);
+    QEmuStringView(longText).toPrettyUnicode(out, -1);
+    QCOMPARE(out, '"' + QByteArray(300, 'x') + '"');
+}
+
+void TESTCLASS::smallStrings() const
+{
+#if defined(QEMUSTRINGVIEW_ZEROCOPY) || !defined(QEMUSTRINGVIEW_SSO)
+    QSKIP("built without QEMUSTRINGVIEW_SSO");
+#else
+    const auto isInside = [](const QEmuStringView &v) {
+        const char *p = reinterpret_cast<const char *>(v.utf16());
+        return p >= reinterpret_cast<const char *>(&v) && p < reinterpret_cast<const char *>(&v + 1);
+    };
+    const char16_t shortText[] = u"identifier_0015";
+    const char16_t longText[] = u"identifier_00016";
+    Q_STATIC_ASSERT(sizeof(shortText) / sizeof(char16_t) - 1 == QEmuStringView::SsoCapacity);
+
+    const QEmuStringView small(shortText);
+    QVERIFY(isInside(small));
+    QCOMPARE(small.size(), qsizetype(15));
+    QCOMPARE(static_cast<const QString &>(small), QStringLiteral("identifier_0015"));
+    QCOMPARE(small.utf16()[15], ushort(0));
+    QVERIFY(!isInside(QEmuStringView(longText)));
+    QVERIFY(!isInside(QEmuStringView(u"")));
+    QVERIFY(QEmuStringView(static_cast<const char16_t *>(nullptr)).isNull());
+
+    // copies get their own inline storage, toString() a heap copy
+    QString copy;
+    {
+        QEmuStringView temporary(shortText, 10);
+        const QEmuStringView copied(temporary);
+        QVERIFY(isInside(copied));
+        QCOMPARE(copied, QEmuStringView(u"identifier"));
+        QEmuStringView assigned(longText);
+        assigned = temporary;
+        QVERIFY(isInside(assigned));
+        QCOMPARE(assigned, temporary);
+        assigned = QEmuStringView(longText);
+        QVERIFY(!isInside(assigned));
+        QCOMPARE(assigned.size(), qsizetype(16));
+        copy = temporary.toString();
+        QVERIFY(copy.constData() != temporary.QString::constData());
+    }
+    QCOMPARE(copy, QStringLiteral("identifier"));
+
+    // short slices and decoded fields do not allocate a raw-data header either
+    const QEmuStringView line(u"alpha beta gamma delta epsilon");
+    QVERIFY(isInside(line.mid(6, 4)));
+    QCOMPARE(line.mid(6, 4), QEmuStringView(u"beta"));
+    QEmuUtf16Buffer buffer;
+    const QEmuStringView decoded = buffer.fromUtf8("caf\xc3\xa9", 5);
+    QVERIFY(isInside(decoded));
+    QCOMPARE(decoded, QEmuStringView(u"café"));
+
+    // writing through QString detaches from the inline storage
+    QEmuStringView modified(shortText, 5);
+    static_cast<QString &>(modified).append(QStringLiteral("s"));
+    QVERIFY(!isInside(modified));
+    QCOMPARE(static_cast<const QString &>(modified), QStringLiteral("idents"));
+#endif
+}
+
+void TESTCLASS::layout() const
+{
+#if !defined(QEMUSTRINGVIEW_ZEROCOPY) && defined(QEMUSTRINGVIEW_SSO)
+    QSKIP("inline storage makes the view larger");
+#else
+    QCOMPARE(sizeof(QEmuStringView), 2 * sizeof(void *));
+    QVERIFY(!QTypeInfo<QEmuStringView>::isStatic);
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+    QVERIFY(std::is_trivially_copyable<QEmuStringView>::value);
+    QVERIFY(!QTypeInfo<QEmuStringView>::isComplex);
+#endif
+
+    // null and empty views stay apart through copies and assignments
+    const char16_t text[] = u"text";
+    const QEmuStringView null(static_cast<const char16_t *>(nullptr));
+    const QEmuStringView empty(text, 0);
+    QVERIFY(null.isNull());
+    QVERIFY(QEmuStringView(nullptr).isNull());
+    QVERIFY(!empty.isNull());
+    QVERIFY(empty.isEmpty());
+    QEmuStringView copy(null);
+    QVERIFY(copy.isNull());
+    copy = empty;
+    QVERIFY(!copy.isNull());
+    QVERIFY(copy.isEmpty());
+    copy = QEmuStringView(text);
+    QCOMPARE(static_cast<const void *>(copy.data()), static_cast<const void *>(text));
+    QCOMPARE(copy.size(), qsizetype(4));
+    copy = null;
+    QVERIFY(copy.isNull());
+    QCOMPARE(copy.size(), qsizetype(0));
+#endif
+}
+
+void TESTCLASS::arena() const
+{
+    const auto aligned = [](const QEmuStringView &v) {
+        return quintptr(v.constData()) % QEmuStringArena::Alignment == 0;
+    };
+    QEmuStringArena arena(64);
+    QVERIFY(arena.copy(QEmuStringView()).isNull());
+    QVERIFY(arena.fromUtf8(nullptr, 0).isNull());
+    const QEmuStringView empty = arena.copy(QEmuStringView(u"", 0));
+    QVERIFY(!empty.isNull());
+    QVERIFY(empty.isEmpty());
+
+    // views into the arena stay valid as it grows, long strings included
+    const char16_t source[] = u"request scoped field";
+    const QString longText(400, QLatin1Char('x'));
+    QVector<QEmuStringView> views;
+    QStringList expected;
+    for (int i = 0; i < 200; ++i) {
+        const QEmuStringView input = i == 100 ? QEmuStringView(longText) : QEmuStringView(source, i % 21);
+        const QEmuStringView v = arena.copy(input);
+        expected.append(input.toString());
+        QVERIFY(aligned(v));
+        QVERIFY(static_cast<const void *>(v.constData()) != static_cast<const void *>(input.constData()));
+        QCOMPARE(reinterpret_cast<const ushort *>(v.constData())[v.size()], ushort(0));
+        views.append(v);
+    }
+    for (int i = 0; i < views.size(); ++i)
+        QCOMPARE(views.at(i), QEmuStringView(expected.at(i)));
+
+    bool ok = false;
+    QCOMPARE(arena.fromUtf8("caf\xc3\xa9", 5, &ok), QEmuStringView(u"café"));
+    QVERIFY(ok);
+    QCOMPARE(arena.fromUtf8(QByteArray("ab\xff"), &ok), QEmuStringView(u"ab\xfffd"));
+    QVERIFY(!ok);
+    QCOMPARE(arena.fromLatin1("caf\xe9", 4), QEmuStringView(u"café"));
+
+    // case mapping agrees with QString, whether or not the input is ASCII
+    const QString mixed[] = {
+        QStringLiteral("Content-Type: text/HTML; charset=UTF-8"),
+        QStringLiteral("Grüße aus Köln, ÉTÉ"),
+        QStringLiteral("@[`{"),
+    };
+    for (const QString &text : mixed) {
+        QCOMPARE(arena.toUpper(QEmuStringView(text)), QEmuStringView(text.toUpper()));
+        QCOMPARE(arena.toLower(QEmuStringView(text)), QEmuStringView(text.toLower()));
+        QCOMPARE(arena.toCaseFolded(QEmuStringView(text)), QEmuStringView(text.toCaseFolded()));
+    }
+
+    // reset() keeps one chunk to serve the next round from
+    arena.reset();
+    const qsizetype kept = arena.capacity();
+    QVERIFY(kept > 0);
+    for (int i = 0; i < 10; ++i)
+        QCOMPARE(arena.toUpper(QEmuStringView(u"abc")), QEmuStringView(u"ABC"));
+    QCOMPARE(arena.capacity(), kept);
+}
+
+void TESTCLASS::interning() const
+{
+    QEmuStringPool pool;
+    QVERIFY(pool.isEmpty());
+    QVERIFY(pool.intern(QEmuStringView()).isNull());
+    QCOMPARE(pool.id(static_cast<const char16_t *>(nullptr)), -1);
+    QCOMPARE(pool.id(QString()), -1);
+
+    // every source type finds the same entry
+    const QString str = QStringLiteral("content-type");
+    const std::u16string stdString(u"content-type");
+    const char16_t *pointer = u"content-type";
+    const QString longer = QStringLiteral("x-content-type");
+    const QEmuStringView canonical = pool.intern(str);
+    QCOMPARE(canonical, QEmuStringView(str));
+    QVERIFY(static_cast<const void *>(canonical.data()) != static_cast<const void *>(str.data()));
+    QCOMPARE(pool.intern(u"content-type").data(), canonical.data());
+    QCOMPARE(pool.intern(pointer).data(), canonical.data());
+    QCOMPARE(pool.intern(stdString).data(), canonical.data());
+    QCOMPARE(pool.intern(longer.midRef(2)).data(), canonical.data());
+    QCOMPARE(pool.intern(QEmuStringView(pointer, 12)).data(), canonical.data());
+    QCOMPARE(pool.id(stdString), 0);
+    QCOMPARE(pool.size(), 1);
+
+    QCOMPARE(pool.indexOf(u"accept"), -1);
+    QVERIFY(pool.find(u"accept").isNull());
+    QVERIFY(!pool.contains(u"accept"));
+    QCOMPARE(pool.size(), 1);
+    QCOMPARE(pool.id(u"accept"), 1);
+    QCOMPARE(pool.id(QString(QLatin1String(""))), 2);
+    QVERIFY(pool.contains(u""));
+    QCOMPARE(pool.at(1), QEmuStringView(u"accept"));
+
+    // ids are dense and views stable while the table grows
+    QStringList names;
+    for (int i = 0; i < 5000; ++i)
+        names.append(QStringLiteral("field_") + QString::number(i));
+    for (const QString &name : names)
+        pool.intern(name);
+    QCOMPARE(pool.size(), 5003);
+    for (int i = 0; i < names.size(); ++i) {
+        QCOMPARE(pool.indexOf(names.at(i)), i + 3);
+        QCOMPARE(pool.at(i + 3), QEmuStringView(names.at(i)));
+    }
+    QCOMPARE(pool.find(str).data(), canonical.data());
+
+    // threads interning the same strings agree on their ids
+    QEmuStringPool shared;
+    std::vector<std::vector<int>> ids(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&shared, &names, &ids, t]() {
+            for (int i = 0; i < 2000; ++i)
+                ids[t].push_back(shared.id(names.at((i * (t + 1)) % 2000)));
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    QCOMPARE(shared.size(), 2000);
+    for (int t = 0; t < 4; ++t) {
+        for (int i = 0; i < 2000; ++i)
+            QCOMPARE(shared.at(ids[t][i]), QEmuStringView(names.at((i * (t + 1)) % 2000)));
+    }
+
+    // threads that look up a new entry all at once only read it
+    for (int round = 0; round < 200; ++round) {
+        QEmuStringPool fresh;
+        const QString &name = names.at(round);
+        const QChar *const chars = fresh.intern(name).constData();
+#if !defined(QEMUSTRINGVIEW_ZEROCOPY) && !defined(QEMUSTRINGVIEW_SSO)
+        // the entry is a fromRawData() QString that a reader must not reallocate
+        const QString::DataPtr entry = fresh.at(0).data_ptr();
+#endif
+        std::atomic<int> ready(0);
+        std::vector<int> found(4);
+        threads.clear();
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&fresh, &name, &ready, &found, t]() {
+                ++ready;
+                while (ready.load() < 4) {}
+                for (int i = 0; i < 100; ++i)
+                    found[t] += fresh.id(name) == 0 && fresh.contains(QEmuStringView(name).mid(0));
+            });
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+        for (int t = 0; t < 4; ++t)
+            QCOMPARE(found[t], 100);
+        QCOMPARE(fresh.at(0).constData(), chars);
+#if !defined(QEMUSTRINGVIEW_ZEROCOPY) && !defined(QEMUSTRINGVIEW_SSO)
+        QCOMPARE(fresh.at(0).data_ptr(), entry);
+#endif
+    }
+}
+
+void TESTCLASS::parallelAlgorithms() const
+{
+    // enough views to be split over threads, with long shared prefixes, duplicates,
+    // code units that differ only in their high byte, and empty and null views
+    uint seed = 7;
+    auto next = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7fff; };
+    static const ushort units[] = { 'a', 'b', 'z', 0xe9, 0x161, 0x6162, 0xd83d, 0xfffe };
+    QStringList strings;
+    for (int i = 0; i < 100000; ++i) {
+        QString str;
+        if (next() % 2)
+            str = QStringLiteral("/usr/share/locale/");
+        const int length = int(next() % 12);
+        for (int j = 0; j < length; ++j)
+            str += QChar(units[next() % 8]);
+        strings.append(str);
+    }
+    QVector<QEmuStringView> views;
+    for (const QString &str : strings)
+        views.append(QEmuStringView(str));
+    views.append(QEmuStringView());
+    views.append(QEmuStringView(u""));
+
+    QVector<QEmuStringView> expected = views;
+    std::sort(expected.begin(), expected.end());
+    for (int threads : { 1, 4 }) {
+        QVector<QEmuStringView> sorted = views;
+        QEmuParallel::sort(sorted, threads);
+        QVERIFY(sorted == expected);
+        // the views still refer to the strings they were made from
+        std::vector<const void *> before, after;
+        for (int i = 0; i < views.size(); ++i) {
+            before.push_back(views.at(i).utf16());
+            after.push_back(sorted.at(i).utf16());
+        }
+        std::sort(before.begin(), before.end());
+        std::sort(after.begin(), after.end());
+        QVERIFY(before == after);
+
+        QVector<QEmuStringView> deduped = views;
+        QEmuParallel::dedup(deduped, threads);
+        QVector<QEmuStringView> reference = expected;
+        reference.erase(std::unique(reference.begin(), reference.end()), reference.end());
+        QVERIFY(deduped == reference);
+
+        QVector<qsizetype> matches;
+        for (int i = 0; i < views.size(); ++i) {
+            if (views.at(i).contains(QStringLiteral("share/locale/\u0161"), Qt::CaseInsensitive))
+                matches.append(i);
+        }
+        QVERIFY(!matches.isEmpty());
+        QVERIFY(QEmuParallel::findAll(views, QStringLiteral("share/locale/\u0161"), Qt::CaseInsensitive, threads) == matches);
+        QVERIFY(QEmuParallel::findAll(views, u"no such text", Qt::CaseSensitive, threads).isEmpty());
+    }
+
+    // a sliced needle and sliced haystacks: in the QString-based mode both are
+    // fromRawData() strings, which the workers must read without detaching them
+    QVector<QEmuStringView> tails;
+    for (const QEmuStringView &view : views)
+        tails.append(view.mid(1));
+    const QString path = QStringLiteral("/usr/share/locale/\u0161");
+    QEmuStringView needle = QEmuStringView(path).mid(5, 13);
+    QCOMPARE(needle, QEmuStringView(u"share/locale/"));
+    QVector<qsizetype> tailMatches;
+    for (int i = 0; i < strings.size(); ++i) {
+        if (strings.at(i).indexOf(QStringLiteral("share/locale/"), 1) >= 0)
+            tailMatches.append(i);
+    }
+    QVERIFY(!tailMatches.isEmpty());
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    const QString::DataPtr needleData = needle.data_ptr();
+    std::vector<QString::DataPtr> tailData;
+    for (QEmuStringView &tail : tails)
+        tailData.push_back(tail.data_ptr());
+#endif
+    for (int threads : { 1, 4 })
+        QVERIFY(QEmuParallel::findAll(tails, needle, Qt::CaseSensitive, threads) == tailMatches);
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    QCOMPARE(needle.data_ptr(), needleData);
+    for (int i = 0; i < tails.size(); ++i)
+        QVERIFY(tails[i].data_ptr() == tailData[size_t(i)]);
+#endif
+
+    // keys that split into one large group and a higher sorting stray at every byte
+    // used to make the radix sort recurse once per byte
+    QStringList chains;
+    QString run;
+    for (int k = 0; k < 2100; ++k) {
+        chains.append(run + QChar('b'));
+        run += QChar('a');
+    }
+    QString dir;
+    for (int level = 0; level < 1000; ++level) {
+        dir += QStringLiteral("/d");
+        chains.append(dir + QStringLiteral("/z"));
+    }
+    QVector<QEmuStringView> chainViews;
+    for (const QString &str : chains)
+        chainViews.append(QEmuStringView(str));
+    QVector<QEmuStringView> chainsSorted = chainViews;
+    std::sort(chainsSorted.begin(), chainsSorted.end());
+    for (int threads : { 1, 4 }) {
+        QVector<QEmuStringView> sorted = chainViews;
+        QEmuParallel::sort(sorted, threads);
+        QVERIFY(sorted == chainsSorted);
+    }
+
+    // small inputs stay on the calling thread
+    QEmuStringView few[] = { QEmuStringView(u"b"), QEmuStringView(u"a"), QEmuStringView(u"b") };
+    QEmuParallel::sort(few, few + 3, 8);
+    QCOMPARE(few[0], QEmuStringView(u"a"));
+    QCOMPARE(QEmuParallel::unique(few, few + 3, 8) - few, 2);
+    QCOMPARE(few[1], QEmuStringView(u"b"));
+}
+
+void TESTCLASS::mappedFile() const
+{
+    const auto utf16File = [](QTemporaryFile &file, const char16_t *text, qsizetype length) {
+        QVERIFY(file.open());
+        file.write(QByteArray(reinterpret_cast<const char *>(text), int(length * sizeof(char16_t))));
+        file.flush();
+    };
+
+    // a byte order mark is skipped, and lines end in \n or \r\n
+    QTemporaryFile withBom;
+    utf16File(withBom, u"\ufefffirst\r\nsecond \u00e9\n\nfourth", 24);
+    QEmuMappedStringView mapped(withBom.fileName());
+    QVERIFY(mapped.isOpen());
+    QVERIFY(mapped.hasByteOrderMark());
+    QCOMPARE(mapped.view(), QEmuStringView(u"first\r\nsecond \u00e9\n\nfourth"));
+    QCOMPARE(mapped.size(), qsizetype(23));
+    const QVector<QEmuStringView> lines = QVector<QEmuStringView>(mapped.lines().begin(), mapped.lines().end());
+    QCOMPARE(lines.size(), 4);
+    QCOMPARE(lines.at(0), QEmuStringView(u"first"));
+    QCOMPARE(lines.at(1), QEmuStringView(u"second \u00e9"));
+    QVERIFY(lines.at(2).isEmpty());
+    QCOMPARE(lines.at(3), QEmuStringView(u"fourth"));
+    // the lines are views onto the mapping
+    QCOMPARE(static_cast<const void *>(lines.at(3).constData()),
+             static_cast<const void *>(mapped.view().constData() + 17));
+    QVERIFY(mapped.advise(QEmuMappedStringView::RandomAccess));
+    // searching reads the mapping in place: in the QString-based mode the view is a
+    // fromRawData() string, which must not be copied to be searched
+    QEmuStringView text = mapped.view();
+    const void *const mapping = text.constData();
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    const QString::DataPtr textData = text.data_ptr();
+#endif
+    QCOMPARE(text.indexOf(QEmuStringView(u"second")), qsizetype(7));
+    QVERIFY(text.contains(QEmuStringView(u"FOURTH"), Qt::CaseInsensitive));
+    QCOMPARE(text.count(QLatin1Char('\n')), qsizetype(3));
+    QCOMPARE(text.lastIndexOf(QChar(0xe9)), qsizetype(14));
+    QCOMPARE(static_cast<const void *>(text.constData()), mapping);
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    QCOMPARE(text.data_ptr(), textData);
+#endif
+
+    // no byte order mark, and no line after a final line feed
+    QTemporaryFile withoutBom;
+    utf16File(withoutBom, u"a\nb\n", 4);
+    QVERIFY(mapped.open(withoutBom.fileName()));
+    QVERIFY(!mapped.hasByteOrderMark());
+    int count = 0;
+    for (QEmuStringView line : mapped.lines())
+        QCOMPARE(line, QEmuStringView(count++ ? u"b" : u"a"));
+    QCOMPARE(count, 2);
+    QVERIFY(QEmuStringLines(QEmuStringView()).begin() == QEmuStringLines(QEmuStringView()).end());
+    QCOMPARE(std::distance(QEmuStringLines(QEmuStringView(u"\n")).begin(), QEmuStringLines(QEmuStringView(u"\n")).end()), 1);
+
+    QTemporaryFile empty;
+    QVERIFY(empty.open());
+    QVERIFY(mapped.open(empty.fileName()));
+    QVERIFY(!mapped.view().isNull());
+    QVERIFY(mapped.view().isEmpty());
+    QVERIFY(mapped.lines().begin() == mapped.lines().end());
+
+    // what cannot be viewed in place
+    QTemporaryFile swapped;
+    utf16File(swapped, u"\ufffe\u6100", 2);
+    QVERIFY(!mapped.open(swapped.fileName()));
+    QVERIFY(!mapped.isOpen());
+    QVERIFY(mapped.view().isNull());
+    QVERIFY(!mapped.errorString().isEmpty());
+    QTemporaryFile odd;
+    QVERIFY(odd.open());
+    odd.write(QByteArray("abc"));
+    odd.flush();
+    QVERIFY(!mapped.open(odd.fileName()));
+    QVERIFY(!mapped.open(QStringLiteral("/nonexistent/file")));
+    mapped.close();
+    QVERIFY(!mapped.isOpen());
+}
+
+void TESTCLASS::recordReader() const
+{
+    // records of all lengths, some longer than the ring, with characters that take
+    // 2, 3 and 4 bytes in UTF-8 to be split between reads
+    QString text;
+    for (int i = 0; i < 300; ++i) {
+        for (int j = 0; j < (i * 37) % 101; ++j)
+            text += i % 3 ? QChar(QLatin1Char('a' + j % 26)) : QChar(ushort(j % 2 ? 0xe9 : 0x20ac));
+        if (i % 7 == 0)
+            text += QString::fromUtf8("\xf0\x9f\x98\x80");
+        text += QLatin1Char('\n');
+    }
+    text += QStringLiteral("no final delimiter");
+    QVector<QEmuStringView> expected;
+    for (qsizetype from = 0; from <= text.size(); ) {
+        qsizetype end = text.indexOf(QLatin1Char('\n'), int(from));
+        if (end < 0)
+            end = text.size();
+        expected.append(QEmuStringView(text).mid(from, end - from));
+        from = end + 1;
+    }
+
+    QByteArray utf8 = "\xef\xbb\xbf" + text.toUtf8();
+    QBuffer buffer(&utf8);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QEmuRecordReader reader(&buffer, QLatin1Char('\n'), QEmuRecordReader::Utf8, 64);
+    QCOMPARE(reader.capacity(), qsizetype(64));
+    int count = 0;
+    for (QEmuStringView record : reader) {
+        QCOMPARE(record, expected.at(count));
+        ++count;
+    }
+    QCOMPARE(count, expected.size());
+    QVERIFY(reader.atEnd());
+    QVERIFY(!reader.hasError());
+    QVERIFY(reader.readRecord().isNull());
+    // only records that wrap around the ring or are longer than it are copied
+    QVERIFY(reader.copiedRecords() > 0);
+    QVERIFY(reader.copiedRecords() < count);
+
+    // UTF-16 from a file descriptor, with another delimiter; the ring never wraps
+    QString semicolons = text;
+    semicolons.replace(QLatin1Char('\n'), QLatin1Char(';'));
+    semicolons.prepend(QChar(0xfeff));
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(QByteArray(reinterpret_cast<const char *>(semicolons.constData()), semicolons.size() * 2));
+    file.flush();
+    QFile in(file.fileName());
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    QEmuRecordReader fromFd(in.handle(), QLatin1Char(';'), QEmuRecordReader::Utf16);
+    for (count = 0; count < expected.size(); ++count)
+        QCOMPARE(fromFd.readRecord(), expected.at(count));
+    QVERIFY(fromFd.readRecord().isNull());
+    QCOMPARE(fromFd.copiedRecords(), qint64(0));
+
+    // a byte order mark in the middle is a character; empty records are not the end
+    QByteArray small = "a\n\n\xef\xbb\xbf\n\xe2\x82";
+    QBuffer smallBuffer(&small);
+    QVERIFY(smallBuffer.open(QIODevice::ReadOnly));
+    QEmuRecordReader smallReader(&smallBuffer);
+    QCOMPARE(smallReader.readRecord(), QEmuStringView(u"a"));
+    const QEmuStringView empty = smallReader.readRecord();
+    QVERIFY(!empty.isNull());
+    QVERIFY(empty.isEmpty());
+    QCOMPARE(smallReader.readRecord(), QEmuStringView(u"\ufeff"));
+    // an incomplete sequence at the end is decoded like QString::fromUtf8() does it
+    QCOMPARE(smallReader.readRecord(), QEmuStringView(u"\ufffd\ufffd"));
+    QVERIFY(smallReader.readRecord().isNull());
+
+    // the 64-byte ring is full after the 32nd record, so U+FEFF starts the second read
+    QByteArray refill;
+    for (int i = 0; i < 32; ++i)
+        refill.append("x\n");
+    refill.append("\xef\xbb\xbf");
+    QBuffer refillBuffer(&refill);
+    QVERIFY(refillBuffer.open(QIODevice::ReadOnly));
+    QEmuRecordReader refillReader(&refillBuffer, QLatin1Char('\n'), QEmuRecordReader::Utf8, 64);
+    for (int i = 0; i < 32; ++i)
+        QCOMPARE(refillReader.readRecord(), QEmuStringView(u"x"));
+    QCOMPARE(refillReader.readRecord(), QEmuStringView(u"\ufeff"));
+    QVERIFY(refillReader.readRecord().isNull());
+
+#ifdef Q_OS_UNIX
+    // UTF-16 through a pipe, written in pieces that split code units, into a small ring
+    int pipeFds[2];
+    QCOMPARE(::pipe(pipeFds), 0);
+    const QByteArray utf16(reinterpret_cast<const char *>(semicolons.constData()), semicolons.size() * 2);
+    std::thread writer([&utf16, &pipeFds]() {
+        for (int i = 0; i < utf16.size(); i += 7) {
+            if (::write(pipeFds[1], utf16.constData() + i, size_t(qMin(7, utf16.size() - i))) < 0)
+                break;
+        }
+        ::close(pipeFds[1]);
+    });
+    QEmuRecordReader fromPipe(pipeFds[0], QLatin1Char(';'), QEmuRecordReader::Utf16, 100);
+    count = 0;
+    for (QEmuStringView record : fromPipe)
+        QCOMPARE(record, expected.at(count++));
+    writer.join();
+    ::close(pipeFds[0]);
+    QCOMPARE(count, expected.size());
+    QVERIFY(!fromPipe.hasError());
+#endif
+
+    // UTF-16 that cannot be read in place
+    QByteArray swapped("\xfe\xff\x00\x61", 4);
+    QBuffer swappedBuffer(&swapped);
+    QVERIFY(swappedBuffer.open(QIODevice::ReadOnly));
+    QEmuRecordReader swappedReader(&swappedBuffer, QLatin1Char('\n'), QEmuRecordReader::Utf16);
+    QVERIFY(swappedReader.readRecord().isNull());
+    QVERIFY(swappedReader.hasError());
+    QByteArray odd("a\0b", 3);
+    QBuffer oddBuffer(&odd);
+    QVERIFY(oddBuffer.open(QIODevice::ReadOnly));
+    QEmuRecordReader oddReader(&oddBuffer, QLatin1Char('\n'), QEmuRecordReader::Utf16);
+    QCOMPARE(oddReader.readRecord(), QEmuStringView(u"a"));
+    QVERIFY(oddReader.hasError());
+}
+
+void TESTCLASS::stringBuilder() const
+{
+    const QString greeting = QStringLiteral("Hello, world");
+    const QEmuStringView hello = QEmuStringView(greeting).left(5);
+    const QEmuStringView world = QEmuStringView(greeting).right(5);
+
+    // QStringBuilder takes views like it takes QStrings
+    const QString joined = hello % QLatin1String(", ") % world % QLatin1Char('!');
+    QCOMPARE(joined, QStringLiteral("Hello, world!"));
+#ifdef COUNT_ALLOCATIONS
+    // and allocates once, for the result
+    const quint64 before = allocationCount.load();
+    const QString once = hello % world % QLatin1String("!!");
+    QCOMPARE(allocationCount.load() - before, quint64(1));
+    QCOMPARE(once, QStringLiteral("Helloworld!!"));
+#endif
+    const QString nothing = QEmuStringView() % QEmuStringView(u"");
+    QVERIFY(nothing.isEmpty());
+
+    QEmuStringBuilder builder;
+    QVERIFY(builder.isEmpty());
+    QVERIFY(builder.toString().isNull());
+    QEmuStringArena arena;
+    QVERIFY(builder.toView(arena).isNull());
+
+    // temporaries are kept, everything else is referred to
+    builder << hello << QLatin1Char(' ') << QString::number(42) << QLatin1String(" \xe9 ")
+            << QEmuStringView() << world << QChar(0x20ac);
+    builder.append(QEmuStringView(u"\u00e9t\u00e9").mid(1)).append(greeting);
+    const QString expected = QStringLiteral("Hello 42 \u00e9 world\u20act\u00e9Hello, world");
+    QCOMPARE(builder.size(), qsizetype(expected.size()));
+    QCOMPARE(builder.toString(), expected);
+    QString prefixed = QStringLiteral(">> ");
+    builder.appendTo(prefixed);
+    QCOMPARE(prefixed, QStringLiteral(">> ") + expected);
+    const QEmuStringView inArena = builder.toView(arena);
+    QCOMPARE(inArena, QEmuStringView(expected));
+    QCOMPARE(inArena.constData()[inArena.size()].unicode(), ushort(0));
+
+    // more pieces and kept characters than fit in the builder itself
+    builder.clear();
+    QVERIFY(builder.isEmpty());
+    QString many;
+    for (int i = 0; i < 200; ++i) {
+        builder << QString::number(i) << world;
+        many += QString::number(i) + QStringLiteral("world");
+    }
+    QCOMPARE(builder.toString(), many);
+}
+
+void TESTCLASS::wideStrings() const
+{
+    // BMP runs long enough for the SIMD paths, broken up by characters that need surrogates
+    static const wchar_t *const pieces[] = {
+        L"abcdefghijklmnopqrstuvwxyz0123456789", L"é", L"￿", L"€", L"x"
+    };
+    const int pieceCount = int(sizeof(pieces) / sizeof(pieces[0]));
+    std::wstring supplementary;
+    if (sizeof(wchar_t) == sizeof(char16_t))
+        supplementary = { wchar_t(0xd83d), wchar_t(0xde00) };
+    else
+        supplementary = { wchar_t(0x1f600) };
+    uint seed = 13;
+    auto next = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7fff; };
+
+    QEmuUtf16Buffer buffer;
+    for (int round = 0; round < 300; ++round) {
+        std::wstring str;
+        const int pieceTotal = int(next() % 10);
+        for (int i = 0; i < pieceTotal; ++i)
+            str += next() % 4 ? std::wstring(pieces[next() % pieceCount]) : supplementary;
+        const QString ref = QString::fromStdWString(str);
+
+        QCOMPARE(buffer.fromStdWString(str).toString(), ref);
+        QCOMPARE(buffer.fromWCharArray(str.c_str(), qsizetype(str.size())).toString(), ref);
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+        const QEmuStringView fromString(str);
+        const QEmuStringView fromPointer(str.c_str());
+        QCOMPARE(fromString.toString(), ref);
+        QCOMPARE(fromPointer.toString(), ref);
+        // data() is the converted text, not the wchar_t input
+        QCOMPARE(QString(fromPointer.data(), int(fromPointer.size())), ref);
+        QVERIFY(!fromPointer.isNull());
+#endif
+    }
+
+    if (sizeof(wchar_t) == sizeof(uint)) {
+        const wchar_t outOfRange[] = { L'a', wchar_t(0x110000), L'b' };
+        QCOMPARE(buffer.fromWCharArray(outOfRange, 3).toString(), QStringLiteral("a\uFFFDb"));
+    } else {
+        // nothing to convert: the view refers to the input
+        const wchar_t text[] = L"text";
+        QCOMPARE(static_cast<const void *>(buffer.fromWCharArray(text, 4).data()), static_cast<const void *>(text));
+    }
+    QVERIFY(buffer.fromWCharArray(nullptr, 0).isNull());
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    QVERIFY(QEmuStringView(static_cast<const wchar_t *>(nullptr)).isNull());
+    QVERIFY(!QEmuStringView(L"").isNull());
+#endif
+}
+
+void TESTCLASS::constexprKeywords() const
+{
+#if defined(QEMUSTRINGVIEW_NO_CONSTEXPR) || !defined(QSTRINGVIEW_EMULATE)
+    QSKIP("needs the constexpr QEMUSTRINGVIEW_ZEROCOPY views");
+#else
+    // a lexer's keyword table, entirely in rodata
+    static constexpr QStringView keywords[] = {
+        QStringViewLiteral("break"), QStringViewLiteral("else"), QStringViewLiteral("for"),
+        QStringViewLiteral("if"), QStringViewLiteral("return"), QStringViewLiteral("while")
+    };
+    Q_STATIC_ASSERT(keywords[3].size() == 2);
+    Q_STATIC_ASSERT(keywords[4].at(2) == QLatin1Char('t'));
+#ifdef QEMUSTRINGVIEW_CONSTEXPR_COMPARISONS
+    Q_STATIC_ASSERT(qHash(QStringViewLiteral("")) == 0);
+    Q_STATIC_ASSERT(qHash(keywords[3]) == 'i' * 31 + 'f');
+    Q_STATIC_ASSERT(keywords[3] == QStringViewLiteral("if"));
+    Q_STATIC_ASSERT(keywords[3] != keywords[2]);
+    Q_STATIC_ASSERT(keywords[0] < keywords[1] && keywords[4] >= keywords[4]);
+    Q_STATIC_ASSERT(QStringViewLiteral("whil") < keywords[5] && QStringViewLiteral("x") > keywords[5]);
+#endif
+
+    // and the same operations at runtime, where the SIMD kernels take over
+    for (size_t i = 1; i < sizeof(keywords) / sizeof(keywords[0]); ++i)
+        QVERIFY(keywords[i - 1] < keywords[i]);
+    const QString token = QStringLiteral("return");
+    QCOMPARE(QStringView(token), keywords[4]);
+    QCOMPARE(qHash(QStringView(token)), qHash(token));
+#endif
+}
+
+void TESTCLASS::hashing() const
+{
+    // the SIMD loop takes 8 characters at a time, CRC32 8 bytes
+    const QString text = QString::fromUtf8("Hello World, this is a rather long string \xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80 to hash!");
+    for (int n = 0; n <= text.size(); ++n) {
+        const QString str = text.left(n);
+        const QEmuStringView v(str.constData(), qsizetype(n));
+        QCOMPARE(qHash(v), qHash(str));
+        QCOMPARE(qHash(v, 1u), qHash(str, 1u));
+        QCOMPARE(qHash(v, 0xdeadbeefu), qHash(str, 0xdeadbeefu));
+        QCOMPARE(QEmuStringViewHash()(v), std::size_t(qHash(str)));
+    }
+    QCOMPARE(qHash(QEmuStringView()), qHash(QString()));
+    // every code unit value, through both halves of the 16 x 16 bit products
+    std::u16string all;
+    for (uint c = 1; c < 0x10000; c += 7)
+        all += char16_t(c);
+    const QString allStr(reinterpret_cast<const QChar *>(all.data()), int(all.size()));
+    QCOMPARE(qHash(QEmuStringView(all.data(), qsizetype(all.size())), 7u), qHash(allStr, 7u));
+    QCOMPARE(qHash(QEmuStringView(all.data(), qsizetype(all.size()))), qHash(allStr));
+#ifndef QEMUSTRINGVIEW_ZEROCOPY
+    // hashing a slice reads it where it is
+    QEmuStringView slice = QEmuStringView(allStr).mid(100, 500);
+    const QString::DataPtr before = slice.data_ptr();
+    QCOMPARE(qHash(slice, 7u), qHash(allStr.mid(100, 500), 7u));
+    QCOMPARE(slice.data_ptr(), before);
+#endif
+
+    // looking views up in QString-keyed containers
+    QHash<QString, int> routes;
+    routes.insert(QStringLiteral("/index"), 1);
+    routes.insert(QStringLiteral("/api/users"), 2);
+    const char16_t request[] = u"GET /api/users HTTP/1.1";
+    const QEmuStringView path(request + 4, 10);
+    QCOMPARE(routes.value(QEmuStringViewKey(path)), 2);
+    QVERIFY(!routes.contains(QEmuStringViewKey(QEmuStringView(request + 4, 4))));
+    QVERIFY(QEmuStringViewKey(QEmuStringView()).string().isNull());
+    QCOMPARE(QEmuStringViewKey(path).string(), QStringLiteral("/api/users"));
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+    QCOMPARE(QEmuStringViewKey(path).string().constData(), path.data());
+#endif
+
+    std::unordered_map<QString, int, QEmuStringViewHash, QEmuStringViewEqual> map;
+    map[QStringLiteral("/index")] = 1;
+    map[QStringLiteral("/api/users")] = 2;
+#if defined(__cpp_lib_generic_unordered_lookup)
+    QCOMPARE(map.find(path)->second, 2);
+#else
+    QCOMPARE(map.find(QEmuStringViewKey(path))->second, 2);
+#endif
+}
+
+void TESTCLASS::instrumentation() const
+{
+#ifndef QEMUSTRINGVIEW_INSTRUMENT
+    QSKIP("built without QEMUSTRINGVIEW_INSTRUMENT");
+#else
+    using namespace QEmuPrivate;
+    const char16_t text[] = u"instrumented";
+    const QString str = QString::fromLatin1("instrumented");
+    QEmuStringViewStats::reset();
+
+    const QEmuStringView fromArray(text);
+    const QEmuStringView fromPointer(static_cast<const char16_t *>(text));
+    const QEmuStringView fromRange(text, text + 5);
+    const QEmuStringView fromQString(str);
+    QCOMPARE(fromQString.toString(), str);
+    delete[] fromRange.toPrettyUnicode();
+    QVERIFY(fromArray == fromPointer.data());
+
+    // counted in the worker's own block, and still there after it exited
+    std::thread worker([&text]() {
+        for (int i = 0; i < 10; ++i)
+            QEmuStringView(text, 3);
+    });
+    worker.join();
+
+    const QEmuStringViewStats::Snapshot s = QEmuStringViewStats::snapshot();
+    QCOMPARE(s.site[SiteArray].objects, quint64(1));
+    QCOMPARE(s.site[SitePointer].objects, quint64(1));
+    QCOMPARE(s.site[SiteRange].objects, quint64(1));
+    QCOMPARE(s.site[SitePointerLength].objects, quint64(10));
+    QCOMPARE(s.site[SiteCompare].objects, quint64(1));
+    QCOMPARE(s.site[SiteToString].allocations, quint64(1));
+    QCOMPARE(s.site[SiteToString].bytesCopied, quint64(24));
+    QCOMPARE(s.site[SiteToPrettyUnicode].objects, quint64(1));
+#ifdef QEMUSTRINGVIEW_ZEROCOPY
+    QCOMPARE(s.site[SiteQStringLike].objects, quint64(1));
+    // only toString() and toPrettyUnicode() allocate
+    QCOMPARE(s.total().allocations, quint64(2));
+#else
+    QCOMPARE(s.site[SiteQString].objects, quint64(1));
+    QCOMPARE(s.site[SiteQString].allocations, quint64(0));
+#ifdef QEMUSTRINGVIEW_SSO
+    // all of them short enough to stay in the view
+    QCOMPARE(s.site[SiteArray].bytesCopied, quint64(0));
+    QCOMPARE(s.site[SiteRange].bytesCopied, quint64(0));
+    QCOMPARE(s.site[SitePointerLength].allocations, quint64(0));
+#else
+    QCOMPARE(s.site[SiteArray].bytesCopied, quint64(24));
+    QCOMPARE(s.site[SiteRange].bytesCopied, quint64(10));
+    QCOMPARE(s.site[SitePointerLength].allocations, quint64(10));
+#endif
+#endif
+
+    QEmuStringViewStats::reset();
+    QCOMPARE(QEmuStringViewStats::snapshot().total().objects, quint64(0));
+#endif
+}
+
 QTEST_APPLESS_MAIN(TESTCLASS)
 #include "tst_qstringview.moc"